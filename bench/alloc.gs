@@ -0,0 +1,17 @@
+// allocation heavy workload: nothing lives long, so this is mostly allocating & freeing small tables, closures, upvalues & strings
+local counter = function(start)
+    local n = start
+    return function()
+        n = n + 1
+        return n
+    end
+end
+
+local total = 0
+for (var i = 0; i < 1000000; i++) do
+    local t = {i, {"x": i}}
+    local next = counter(i)
+    local str = "s" .. i
+    total = total + t[0] + t[1].x + next() + #str
+end
+print(total)
@@ -0,0 +1,20 @@
+// arithmetic & comparisons on locals and constants, exercises the register instructions
+function arith(n)
+    var sum = 0;
+    var x = 0;
+    for (var i = 0; i < n; i = i + 1) do
+        x = i * 3;
+        x = x % 7;
+        if x >= 3 then
+            sum = sum + x;
+        else
+            sum = sum - 1;
+        end
+    end
+    return sum;
+end
+
+var total = 0;
+for (var i = 0; i < 20; i++) do
+    total = total + arith(10000);
+end
@@ -0,0 +1,19 @@
+// array heavy workload: builds big arrays with t[i] = x, then reads & iterates them
+local build = function(n)
+    local t = {}
+    for (var i = 0; i < n; i++) do
+        t[i] = i
+    end
+    return t
+end
+
+local total = 0
+for (var r = 0; r < 5; r++) do
+    local t = build(200000)
+    for (var i = 0; i < #t; i++) do
+        total = total + t[i]
+    end
+    for (k, v in t) do
+        total = total + v
+    end
+end
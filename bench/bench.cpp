@@ -0,0 +1,82 @@
+/* GavelScript benchmark runner
+    Compiles a script once, runs it [runs] times and reports the wall time & how many instructions per second the vm executed.
+
+    build it with 'make bench', which builds both dispatch modes so you can compare them:
+        bin/bench bench/dispatch.gs 5
+        bin/bench-switch bench/dispatch.gs 5
+
+    it also builds bin/bench-nanbox (GAVEL_NANBOXING) to compare GValue layouts, the peak RSS it reports is for the whole process.
+    the GC heap it reports is what the GC is tracking when the last run finishes, next to the RSS at that point.
+*/
+
+#define _GAVEL_INIT
+#define GAVEL_COUNTINSTRUCTIONS
+#include "../src/gavel.h"
+
+#include <chrono>
+#include <fstream>
+#include <sys/resource.h>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <script> [runs]" << std::endl;
+        return 1;
+    }
+
+    int runs = argc > 2 ? atoi(argv[2]) : 1;
+
+    // load file to string
+    std::ifstream ifs(argv[1]);
+    std::string script((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+
+    GState* state = Gavel::newState();
+    GavelLib::loadLibrary(state);
+
+    GavelParser compiler(script.c_str());
+    if (!compiler.compile()) {
+        std::cout << argv[1] << ": " << compiler.getObjection().getFormatedString() << std::endl;
+        return 1;
+    }
+    GObjectFunction* mainFunc = compiler.getFunction();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        if (state->start(mainFunc) != GSTATE_OK) {
+            std::cout << argv[1] << ": " << state->getObjection().getFormatedString() << std::endl;
+            return 1;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+#ifdef GAVEL_COMPUTEDGOTO
+    std::cout << "dispatch     : computed goto" << std::endl;
+#else
+    std::cout << "dispatch     : switch" << std::endl;
+#endif
+#ifdef GAVEL_NANBOXING
+    std::cout << "GValue       : nan-boxed (" << sizeof(GValue) << " bytes)" << std::endl;
+#else
+    std::cout << "GValue       : tagged union (" << sizeof(GValue) << " bytes)" << std::endl;
+#endif
+    std::cout << "script       : " << argv[1] << " (" << runs << " runs)" << std::endl;
+    std::cout << "instructions : " << state->instructionCount << std::endl;
+    std::cout << "time         : " << elapsed.count() << "s" << std::endl;
+    std::cout << "instrs/sec   : " << (state->instructionCount / elapsed.count()) / 1000000 << "M" << std::endl;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << "peak RSS     : " << usage.ru_maxrss / 1024.0 << "MB" << std::endl;
+
+    // what the GC is tracking when the script finishes, compared to what the process is actually using
+    Gavel::GHeapStats heap = Gavel::getHeapStats();
+    std::cout << "GC heap      : " << heap.objectBytes / 1048576.0 << "MB (" << heap.internBytes / 1048576.0 << "MB of intern set, " << heap.chunkBytes / 1048576.0 << "MB of chunks, " << heap.poolBytes / 1048576.0 << "MB of pool pages)" << std::endl;
+    std::cout << "RSS          : " << heap.rss / 1048576.0 << "MB" << std::endl;
+
+    Gavel::GGCStats gc = Gavel::getGCStats();
+    std::cout << "collections  : " << gc.collections << " full, " << gc.minorCollections << " minor" << std::endl;
+    std::cout << "GC pauses    : " << gc.pauses << " (" << gc.totalPause / 1000 << "ms total, " << gc.longestPause / 1000 << "ms longest)" << std::endl;
+
+    delete mainFunc;
+    Gavel::freeState(state);
+    return 0;
+}
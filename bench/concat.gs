@@ -0,0 +1,17 @@
+// log building workload: appends 20k formatted lines to one big string (s = s .. x is O(n^2) without ropes), then checks the result
+var log = ""
+for (var i = 0; i < 20000; i++) do
+    log = log .. "[" .. i .. "] request handled in " .. (i % 37) .. "ms\n"
+end
+
+// a local one too, & some reads of it along the way
+local out = ""
+local checks = 0
+for (var i = 0; i < 20000; i++) do
+    out = out .. "line " .. i .. ";"
+    if out[#out - 1] == ';' then
+        checks = checks + 1
+    end
+end
+
+print(#log, " ", #out, " ", checks)
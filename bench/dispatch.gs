@@ -0,0 +1,15 @@
+// same hot loop as main.gs, minus the printing so we're only measuring the vm
+local fact = function(num)
+    local total = 1
+    for (var i = num; i > 1; i=i-1) do
+        total = total * i
+    end
+    return total
+end
+
+var total = 0
+for (var i = 1000; i > 0; --i) do
+    for (var x = 100; x > 0; --x) do
+        total = total + fact(x)
+    end
+end
@@ -0,0 +1,13 @@
+// gc workload: keeps a big heap alive while making lots of short-lived strings & tables (the case minor collections are for)
+local live = {}
+for (var i = 0; i < 200000; i++) do
+    live[i] = {i, "live" .. i}
+end
+
+local total = 0
+for (var i = 0; i < 1000000; i++) do
+    local tmp = {i, i + 1}
+    local str = "tmp" .. i
+    total = total + tmp[1] + #live[i % 200000]
+end
+print(total)
@@ -0,0 +1,11 @@
+// global heavy workload: calls global functions & reads/writes global variables in a tight loop
+var counter = 0
+var add = function(a, b)
+    return a + b
+end
+
+for (var i = 0; i < 1000000; i++) do
+    counter = add(counter, i)
+    counter = add(counter, tonumber("1"))
+end
+print(counter)
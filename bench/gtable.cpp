@@ -0,0 +1,86 @@
+/* GTable microbenchmarks
+    Times insert, lookup hit, lookup miss & iteration on a GTable<GValue> (what GObjectTable uses) with number & string keys, at 10, 1k and 1M entries.
+    Small tables are rebuilt/re-read until roughly the same amount of work as the big one was done, results are in nanoseconds per operation.
+
+    build it with 'make bench', then run bin/bench-gtable
+*/
+
+#define _GAVEL_INIT
+#include "../src/gavel.h"
+
+#include <chrono>
+
+// stops the compiler from optimizing our lookups away
+static volatile double sink;
+
+template <typename F>
+static double timeIt(F func) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+static void runSuite(const char* name, std::vector<GValue>& keys, std::vector<GValue>& missing, int size) {
+    const int totalOps = 2000000;
+    int rounds = std::max(1, totalOps / size);
+    double insert = 0, hit = 0, miss = 0, iter = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        GTable<GValue> tbl;
+        insert += timeIt([&]() {
+            for (int i = 0; i < size; i++)
+                tbl.setIndex(keys[i], CREATECONST_NUMBER(i));
+        });
+
+        hit += timeIt([&]() {
+            double total = 0;
+            for (int i = 0; i < size; i++)
+                total += READGVALUENUMBER(tbl.getIndex(keys[i]));
+            sink = total;
+        });
+
+        miss += timeIt([&]() {
+            int total = 0;
+            for (int i = 0; i < size; i++)
+                total += ISGVALUENIL(tbl.getIndex(missing[i]));
+            sink = total;
+        });
+
+        iter += timeIt([&]() {
+            double total = 0;
+            for (auto& node : tbl)
+                total += READGVALUENUMBER(node.val);
+            sink = total;
+        });
+    }
+
+    double ops = (double)rounds * size;
+    printf("%-8s %9d %12.1f %12.1f %12.1f %12.1f\n", name, size, insert / ops, hit / ops, miss / ops, iter / ops);
+}
+
+int main() {
+    const int sizes[] = {10, 1000, 1000000};
+    printf("%-8s %9s %12s %12s %12s %12s\n", "keys", "entries", "insert", "hit", "miss", "iterate");
+
+    for (int size : sizes) {
+        std::vector<GValue> keys, missing;
+        for (int i = 0; i < size; i++) {
+            keys.push_back(CREATECONST_NUMBER(i));
+            missing.push_back(CREATECONST_NUMBER(-i - 1));
+        }
+        runSuite("number", keys, missing, size);
+    }
+
+    for (int size : sizes) {
+        // strings are owned by the vm, they're safe since we never give the gc a chance to run
+        std::vector<GValue> keys, missing;
+        for (int i = 0; i < size; i++) {
+            keys.push_back(CREATECONST_STRING("key" + std::to_string(i)));
+            missing.push_back(CREATECONST_STRING("missing" + std::to_string(i)));
+        }
+        runSuite("string", keys, missing, size);
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/* Parallel mark benchmark
+    Runs a script that builds a big object graph & keeps it alive (bench/wide.gs), then times full collections with 1, 2, 4... mark threads up to the core 
+    count. Marking should scale with the threads, sweeping (which only frees what's dead) doesn't use them.
+
+    build it with 'make bench', then run:
+        bin/bench-mark bench/wide.gs
+        bin/bench-mark bench/wide.gs 8 (the last argument is the max amount of mark threads, it defaults to the core count)
+*/
+
+#define _GAVEL_INIT
+#include "../src/gavel.h"
+
+#include <chrono>
+#include <fstream>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <script> [max threads]" << std::endl;
+        return 1;
+    }
+
+    int maxThreads = argc > 2 ? atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+
+    // load file to string
+    std::ifstream ifs(argv[1]);
+    std::string script((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+
+    GState* state = Gavel::newState();
+    GavelLib::loadLibrary(state);
+
+    GavelParser compiler(script.c_str());
+    if (!compiler.compile()) {
+        std::cout << argv[1] << ": " << compiler.getObjection().getFormatedString() << std::endl;
+        return 1;
+    }
+    GObjectFunction* mainFunc = compiler.getFunction();
+
+    if (state->start(mainFunc) != GSTATE_OK) {
+        std::cout << argv[1] << ": " << state->getObjection().getFormatedString() << std::endl;
+        return 1;
+    }
+
+    Gavel::collectGarbage(); // get rid of the garbage the script made, so we're only timing the live graph
+    std::cout << "script       : " << argv[1] << " (" << Gavel::getHeapStats().objectBytes / 1048576.0 << "MB live)" << std::endl;
+    std::cout << "cores        : " << std::thread::hardware_concurrency() << std::endl;
+
+    // 1, 2, 4... & the max
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double baseline = 0;
+    for (int threads : threadCounts) {
+        Gavel::setMarkThreads(threads);
+
+        // best of 5
+        double mark = 0, sweep = 0;
+        for (int i = 0; i < 5; i++) {
+            auto start = std::chrono::steady_clock::now();
+            Gavel::startCycle();
+            Gavel::traceReferences();
+            auto marked = std::chrono::steady_clock::now();
+            Gavel::finishCollection();
+            auto swept = std::chrono::steady_clock::now();
+
+            double m = std::chrono::duration<double, std::milli>(marked - start).count();
+            double s = std::chrono::duration<double, std::milli>(swept - marked).count();
+            if (i == 0 || m < mark) mark = m;
+            if (i == 0 || s < sweep) sweep = s;
+        }
+
+        if (threads == 1)
+            baseline = mark;
+
+        std::cout << std::setw(3) << threads << " threads  : mark " << mark << "ms (" << baseline / mark << "x), sweep " << sweep << "ms" << std::endl;
+    }
+
+    delete mainFunc;
+    Gavel::freeState(state);
+    return 0;
+}
@@ -0,0 +1,9 @@
+// native call heavy workload: tiny c functions called from a hot loop
+local sin = math.sin
+local cos = math.cos
+local bxor = bit.bxor
+local total = 0
+for (var i = 0; i < 300000; i++) do
+    total = total + sin(i) * cos(i)
+    total = bxor(total, i)
+end
@@ -0,0 +1,22 @@
+// number formatting workload: the factorial printing loop from main.gs (100k numbers through print) & another 100k through concat.
+// it prints a lot, so pipe it into tail: bin/bench bench/numbers.gs | tail -11
+local fact = function(num)
+    local total = 1
+    for (var i = num; i > 1; i=i-1) do
+        total = total * i
+    end
+    return total
+end
+
+for (var i = 1000; i > 0; --i) do
+    for (var x = 100; x > 0; --x) do
+        print("The factorial of ", x, " is ", fact(x))
+    end
+end
+
+local len = 0
+for (var i = 0; i < 100000; i++) do
+    local str = "x = " .. i / 8
+    len = len + #str
+end
+print(len)
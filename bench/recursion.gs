@@ -0,0 +1,16 @@
+// call heavy workload: deep recursion (way past the old 64 call limit) & lots of tiny function calls
+function depth(n)
+    if n == 0 then return 0 end
+    return 1 + depth(n - 1)
+end
+
+function fib(n)
+    if n < 2 then return n end
+    return fib(n - 1) + fib(n - 2)
+end
+
+local total = 0
+for (var i = 0; i < 500; i++) do
+    total = total + depth(1000)
+end
+total = total + fib(25)
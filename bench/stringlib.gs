@@ -0,0 +1,15 @@
+// string library workload: splits, trims & rebuilds 100k csv-ish lines with the native string functions
+local line = " id=42, name=gavel , tags=fast;small;embeddable , score=9.5 "
+local total = 0
+for (var i = 0; i < 100000; i++) do
+    local fields = string.split(line, ",")
+    for (var f = 0; f < #fields; f++) do
+        fields[f] = string.trim(fields[f])
+    end
+
+    local out = string.format("%d: %s", i, string.replace(string.join(fields, "|"), ";", " "))
+    if string.startswith(out, "1") then
+        total = total + 1
+    end
+end
+print(total, " ", string.rep("-", 10))
@@ -0,0 +1,13 @@
+// string interning workload: makes 1M distinct strings (and keeps them alive in an array), then looks them up again
+local strs = {}
+for (var i = 0; i < 1000000; i++) do
+    strs[i] = "key" .. i
+end
+
+local hits = 0
+for (var i = 0; i < 1000000; i++) do
+    if strs[i] == "key" .. i then
+        hits = hits + 1
+    end
+end
+print(hits)
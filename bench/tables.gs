@@ -0,0 +1,29 @@
+// table heavy workload: fills big tables with numbers & nested tables, then reads them back. compare bin/bench & bin/bench-nanbox
+local fill = function(n)
+    local t = {}
+    for (var i = 0; i < n; i++) do
+        t[i] = i * 2
+    end
+    return t
+end
+
+local points = function(n)
+    local t = {}
+    for (var i = 0; i < n; i++) do
+        t[i] = {"x": i, "y": i + 1, "z": i + 2}
+    end
+    return t
+end
+
+local total = 0
+local nums = fill(200000)
+local pts = points(50000)
+for (var r = 0; r < 5; r++) do
+    for (var i = 0; i < 200000; i++) do
+        total = total + nums[i]
+    end
+    for (var i = 0; i < 50000; i++) do
+        local p = pts[i]
+        total = total + p.x + p.y + p.z
+    end
+end
@@ -0,0 +1,92 @@
+/* Multithreaded throughput benchmark
+    Runs one interpreter per thread, each in it's own isolate (see Gavel::GIsolate), with 1, 2, 4... threads up to the core count. Every thread compiles
+    the script & runs it [runs] times, the total scripts finished per second should scale with the number of threads.
+
+    build it with 'make bench', then run:
+        bin/bench-threads bench/alloc.gs 3
+        bin/bench-threads bench/gc.gs 1 8 (the last argument is the max amount of threads, it defaults to the core count)
+*/
+
+#define _GAVEL_INIT
+#include "../src/gavel.h"
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+static void runInterpreter(const std::string* script, int runs, bool* ok) {
+    Gavel::GIsolate* iso = Gavel::newIsolate();
+    GState* state = Gavel::newState(iso); // also makes iso current for this thread
+    GavelLib::loadLibrary(state);
+
+    GavelParser compiler(script->c_str());
+    if (!compiler.compile()) {
+        *ok = false;
+        Gavel::freeIsolate(iso);
+        return;
+    }
+    GObjectFunction* mainFunc = compiler.getFunction();
+
+    for (int i = 0; i < runs; i++) {
+        if (state->start(mainFunc) != GSTATE_OK) {
+            *ok = false;
+            break;
+        }
+    }
+
+    delete mainFunc;
+    Gavel::freeIsolate(iso);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <script> [runs] [max threads]" << std::endl;
+        return 1;
+    }
+
+    int runs = argc > 2 ? atoi(argv[2]) : 1;
+    int maxThreads = argc > 3 ? atoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+
+    // load file to string
+    std::ifstream ifs(argv[1]);
+    std::string script((std::istreambuf_iterator<char>(ifs)), (std::istreambuf_iterator<char>()));
+
+    std::cout << "script       : " << argv[1] << " (" << runs << " runs per thread)" << std::endl;
+    std::cout << "cores        : " << std::thread::hardware_concurrency() << std::endl;
+
+    // 1, 2, 4... & the max
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    double baseline = 0;
+    for (int threads : threadCounts) {
+        std::vector<std::thread> workers;
+        std::unique_ptr<bool[]> ok(new bool[threads]);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < threads; i++) {
+            ok[i] = true;
+            workers.emplace_back(runInterpreter, &script, runs, &ok[i]);
+        }
+        for (std::thread& t : workers)
+            t.join();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        for (int i = 0; i < threads; i++) {
+            if (!ok[i]) {
+                std::cout << argv[1] << ": failed to compile or run!" << std::endl;
+                return 1;
+            }
+        }
+
+        double perSec = (threads * runs) / elapsed.count();
+        if (threads == 1)
+            baseline = perSec;
+
+        std::cout << std::setw(3) << threads << " threads  : " << elapsed.count() << "s, " << perSec << " runs/sec (" << perSec / baseline << "x)" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,9 @@
+// wide object graph for bin/bench-mark: 500 tables, each holding 1000 small tables. it's kept alive in a global so every collection has to mark all of it
+var graph = {}
+for (var i = 0; i < 500; i++) do
+    local row = {}
+    for (var j = 0; j < 1000; j++) do
+        row[j] = {j, "x": i}
+    end
+    graph[i] = row
+end
@@ -34,11 +34,26 @@
 #include <iomanip>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <type_traits>
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <atomic>
+#include <new>
+
+#ifndef GAVEL_NO_GCTHREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h> // sysconf() for Gavel::getRSS(), write() for GFdSink
+#endif
 
 // add x to show debug info
 #define DEBUGLOG(x) 
@@ -50,24 +65,106 @@
 #define GAVEL_MAJOR "1"
 #define GAVEL_MINOR "0"
 
-// because of this, recursion is limited to 64 calls deep. (aka, FEEL FREE TO CHANGE THIS BASED ON YOUR NEEDS !!!)
-#define CALLS_MAX 64
-#define STACK_MAX CALLS_MAX * 8
-#define MAX_LOCALS STACK_MAX - 1
+// because of this, recursion is limited to 1024 calls deep. (aka, FEEL FREE TO CHANGE THIS BASED ON YOUR NEEDS !!!)
+//  * script to script calls don't use the C stack, so this is only limited by the memory you want each GState to use
+#define CALLS_MAX 1024
+#define STACK_MAX CALLS_MAX * 16
+// max locals per function, a new frame is only pushed if there's at least this much room left on the stack
+#define MAX_LOCALS 256
 
-// enables string interning if defined
-//#define GSTRING_INTERN
+// enables string interning if defined. every string with the same contents is the same GObjectString, so comparing strings (and looking them up in tables) is just a pointer compare
+#define GSTRING_INTERN
 
 // excludes the compiler/lexer if defined. (this also removes compileString in the API!)
 //#define EXCLUDE_COMPILER
 
-// this only tracks memory DYNAMICALLY allocated for GObjects! the other memory is cleaned and managed by their respective classes or the user.
-//  * this will dynamically change, balancing the work.
-#define GC_INITALMEMORYTHRESH 1024 * 16
+// forces GState::run() to dispatch instructions using the plain switch if defined. otherwise compilers that support labels-as-values (GCC, Clang)
+// get a direct-threaded jump table, which gives every instruction it's own indirect branch (which the cpu can predict MUCH better)
+//#define GAVEL_NO_COMPUTEDGOTO
+
+// disables the peephole pass (GChunk::optimize()) ran after GavelParser::compile() if defined, so the disassembly matches what the parser emitted. handy for debugging the parser
+//#define GAVEL_NO_PEEPHOLE
+
+// counts every instruction executed by a GState in GState::instructionCount if defined. (the benchmarks use this, it costs a little performance)
+//#define GAVEL_COUNTINSTRUCTIONS
+
+// packs GValues into 8 bytes using NaN-boxing if defined. (numbers are stored as-is, everything else hides in the payload of a quiet NaN.) 
+// otherwise GValues are a tagged union, which is 16 bytes with padding. requires 64bit pointers that fit in 48 bits (x86_64, aarch64)
+//#define GAVEL_NANBOXING
+
+#if defined(__GNUC__) && !defined(GAVEL_NO_COMPUTEDGOTO)
+#define GAVEL_COMPUTEDGOTO
+#endif
+
+// the first full collection starts once this many bytes of GObjects are allocated, & the threshold never drops below it. (this only tracks memory 
+// DYNAMICALLY allocated for GObjects! the other memory is cleaned and managed by their respective classes or the user.)
+//  * can be changed with Gavel::setMinThreshold()
+#define GC_MINTHRESHOLD 1024 * 16
+
+// after a full collection, the next one starts once the heap grows to this percent of what survived. (200 waits for it to double)
+//  * can be changed with Gavel::setGrowth()
+#define GC_GROWTH 200
+
+// how many bytes of new objects can be allocated before a minor collection. (only objects allocated since the last collection are traced & swept by those!)
+//  * can be changed with Gavel::setNurserySize()
+#define GC_NURSERYSIZE 1024 * 256
+
+// full collections are split into slices ran in between instructions, this is how long (in microseconds) a slice should take. 0 makes full collections stop-the-world
+//  * can be changed with Gavel::setMaxPause()
+#define GC_MAXPAUSE 1000
+
+// how many bytes can be allocated in between slices of a full collection
+#define GC_STEPSIZE 1024 * 64
+
+// the most memory (in bytes) the GC will let an isolate's objects use, 0 for no limit. once it's hit a full collection is forced & if that doesn't free 
+// enough, the script gets a "memory limit exceeded" objection
+//  * can be changed with Gavel::setMemoryLimit()
+#define GC_MEMORYLIMIT 0
+
+// how many threads mark objects in a collection (the collecting thread + helpers), 1 marks on the collecting thread only
+//  * can be changed with Gavel::setMarkThreads()
+#define GC_MARKTHREADS 1
 
-// defines a max string count before causing a garbage collection. will be ignored if string interning is disabled!
-//  * this will dynamically change, balancing the work.
-#define GC_INITIALSTRINGSTHRESH 128
+// the helpers are only woken up once there's at least this many grey objects, it isn't free!
+#define GC_PARALLELMIN 256
+
+// the sweep after a full collection is done on a background thread, so the only pause is marking. can be changed with Gavel::setBackgroundSweep()
+#define GC_BACKGROUNDSWEEP true
+
+// excludes the parallel marker & background sweeper (& std::thread) if defined
+//#define GAVEL_NO_GCTHREADS
+
+// GObjects are allocated out of size-class pools (see GPool), define this to use plain new/delete instead. (handy with -fsanitize=address, which can't see inside the pools)
+//#define GAVEL_NO_POOL
+
+// OP_CONCAT makes a rope (see GObjectRope) instead of a string once the result is at least this long, so appending to it over & over doesn't copy it every time
+#define GSTRING_ROPEMIN 64
+
+// numbers are printed like printf("%.14g") by default, so 0.1 + 0.2 prints 0.3. define this to print the shortest string that reads back as the exact same
+// number instead (0.30000000000000004)
+//#define GAVEL_SHORTESTNUMBERS
+// the most characters formatNumber() will write
+#define GNUMBER_MAXCHARS 32
+
+// print writes into a per-state buffer this big, it's only handed to the GState's output sink (see GOutput) once it's full or flushed
+#define GOUTPUT_BUFFERSIZE 16384
+
+// how long (in milliseconds) print can leave output sitting in the buffer, so long running scripts still show it. 0 only flushes when it's full or 
+// when the state returns to the host
+//  * can be changed with GOutput::setFlushInterval()
+#define GOUTPUT_FLUSHINTERVAL 100
+
+// the VM only looks at the clock for the flush interval every this many loop back-edges/calls/allocations (see GOutput::tick())
+#define GOUTPUT_TICKS 1024
+
+// heap snapshots (see Gavel::writeHeapSnapshot()), names longer than GSNAPSHOT_MAXNAME are cut off
+#define GSNAPSHOT_MAGIC "GHEAP"
+#define GSNAPSHOT_VERSION 1
+#define GSNAPSHOT_MAXNAME 48
+
+// size of the pages the pools carve objects out of, & the biggest object that gets pooled (anything bigger uses the regular heap)
+#define GPOOL_PAGESIZE 1024 * 64
+#define GPOOL_MAXSIZE 128
 
 // switched to 32bit instructions!
 typedef uint32_t INSTRUCTION;
@@ -85,10 +182,11 @@ typedef uint32_t INSTRUCTION;
         - iAx
             - 'Opcode' : 6 bits
             - 'Ax' : 26 bits [MAX: 67108864]
-        - iAB
+        - iABC
             - 'Opcode' : 6 bits
-            - 'A' : 13 bits [MAX: 8192]
-            - 'B' : 13 bits [MAX: 8192]
+            - 'A' : 8 bits [MAX: 256]
+            - 'B' : 9 bits [MAX: 512]
+            - 'C' : 9 bits [MAX: 512]
 */
 #define SIZE_OP		        6
 #define SIZE_Ax		        26
@@ -125,22 +223,32 @@ typedef uint32_t INSTRUCTION;
     o: OpCode, eg. OP_POP
     a: Ax, A eg. 1
     b: B eg. 2
+    c: C eg. 3
 
-    TODO: use more register-based instructions, eg. OP_ADD A, B, C:
-        A: slot 1
-        B: slot 2
-        C: slot 3 to move result too, could be slot 1 or 2 to replace the value on the stack
+    Register-based instructions (eg. OP_ADDRK A, B, C) read their operands straight from the current frame instead of the stack:
+        A: local slot to move the result to, 0 pushes the result onto the stack instead (slot 0 is always the function being called anyways)
+        B: RK operand 1
+        C: RK operand 2
 */
 #define CREATE_i(o)	            (((INSTRUCTION)(o))<<POS_OP)
 #define CREATE_iAx(o,a)	        ((((INSTRUCTION)(o))<<POS_OP) | (((INSTRUCTION)(a))<<POS_A))
 #define CREATE_iABx(o,a,b)      ((((INSTRUCTION)(o))<<POS_OP) | (((INSTRUCTION)(a))<<POS_A) | (((INSTRUCTION)(b))<<POS_B))
 #define CREATE_iABC(o,a,b,c)    ((((INSTRUCTION)(o))<<POS_OP) | (((INSTRUCTION)(a))<<POS_A) | (((INSTRUCTION)(b))<<POS_B) | (((INSTRUCTION)(c))<<POS_C))
 
+// RK operands are either a local slot or a constant index. if the high bit of B or C is set, it's a constant!
+#define BITRK                   (1 << (SIZE_B - 1))
+#define ISK(x)                  ((x) & BITRK)
+#define INDEXK(x)               ((int)(x) & ~BITRK)
+#define RKASK(x)                ((x) | BITRK)
+// max local slot or constant index an RK operand can hold
+#define MAXINDEXRK              (BITRK - 1)
+
 // ===========================================================================[[ VIRTUAL MACHINE ]]===========================================================================
 
 typedef enum {
     OPTYPE_I,
     OPTYPE_IAX,
+    OPTYPE_IABC,
     OPTYPE_CLOSURE
 } OPTYPE;
 
@@ -175,6 +283,9 @@ typedef enum { // [MAX : 64]
     OP_EQUAL,       // i - pushes (stack[top] == stack[top-1])
     OP_GREATER,     // i - pushes (stack[top] > stack[top-1])
     OP_LESS,        // i - pushes (stack[top] < stack[top-1])
+    OP_EQUALRK,     // iABC - R[A] = (RK[B] == RK[C])
+    OP_GREATERRK,   // iABC - R[A] = (RK[B] > RK[C])
+    OP_LESSRK,      // iABC - R[A] = (RK[B] < RK[C])
 
     //              ===================================[[BITWISE OP]]===================================
     OP_NEGATE,      // i - Negates stack[top], and pushes result onto the stack
@@ -185,6 +296,11 @@ typedef enum { // [MAX : 64]
     OP_MUL,         // i - multiplies stack[top] with stack[top-1], pushes result onto the stack
     OP_DIV,         // i - divides stack[top] with stack[top-1], pushes result onto the stack
     OP_MOD,         // i - takes the modulus of stack[top-1] from stack[top], pushes results onto the stack
+    OP_ADDRK,       // iABC - R[A] = RK[B] + RK[C]
+    OP_SUBRK,       // iABC - R[A] = RK[B] - RK[C]
+    OP_MULRK,       // iABC - R[A] = RK[B] * RK[C]
+    OP_DIVRK,       // iABC - R[A] = RK[B] / RK[C]
+    OP_MODRK,       // iABC - R[A] = fmod(RK[B], RK[C])
     
     OP_INC,         // iAx - Increments stack[top] by 1, pushes 2 results onto the stack. one to use to assign, one to use as a value. Ax == 1: pushed value is pre inc; Ax == 2: pushed value is post inc.
     OP_DEC,         // iAx - Decrements stack[top] by 1, pushes 2 results onto the stack. one to use to assign, one to use as a value. Ax == 1: pushed value is pre dec; Ax == 2: pushed value is post dec.
@@ -192,6 +308,15 @@ typedef enum { // [MAX : 64]
     //              ===================================[[STRING OP]]===================================
     OP_CONCAT,      // iAx - Concatenates Ax strings/GValues on the stack, toString is used to convert *all* GValues into strings
 
+    //              ================================[[SUPERINSTRUCTIONS]]===============================
+    //              these are never emitted by the parser, GChunk::optimize() fuses common sequences into them
+    OP_GETBASE2,    // iABC - Pushes stack[base-A] and then stack[base-B]
+    OP_ADDK,        // iAx - adds const[Ax] to stack[top], pushes result onto the stack
+    OP_INCLOCAL,    // iABC - Increments (B == 0) or decrements (B == 1) stack[base-A]. C == 0: pushes nothing; C == 1: pushes the old value; C == 2: pushes the new value
+    OP_EQJMP,       // iABC - if (RK[B] == RK[C]) == A, jumps using the OP_JMP after it. otherwise that OP_JMP is skipped
+    OP_LTJMP,       // iABC - if (RK[B] < RK[C]) == A, jumps using the OP_JMP after it. otherwise that OP_JMP is skipped
+    OP_GTJMP,       // iABC - if (RK[B] > RK[C]) == A, jumps using the OP_JMP after it. otherwise that OP_JMP is skipped
+
     //              ====================================[[LITERALS]]====================================
     OP_TRUE,
     OP_FALSE,
@@ -230,6 +355,9 @@ const OPTYPE GInstructionTypes[] { // [MAX : 64]
     OPTYPE_I,       // OP_EQUAL
     OPTYPE_I,       // OP_GREATER
     OPTYPE_I,       // OP_LESS
+    OPTYPE_IABC,    // OP_EQUALRK
+    OPTYPE_IABC,    // OP_GREATERRK
+    OPTYPE_IABC,    // OP_LESSRK
     
     OPTYPE_I,       // OP_NEGATE
     OPTYPE_I,       // OP_NOT
@@ -239,11 +367,23 @@ const OPTYPE GInstructionTypes[] { // [MAX : 64]
     OPTYPE_I,       // OP_MUL
     OPTYPE_I,       // OP_DIV
     OPTYPE_I,       // OP_MOD
+    OPTYPE_IABC,    // OP_ADDRK
+    OPTYPE_IABC,    // OP_SUBRK
+    OPTYPE_IABC,    // OP_MULRK
+    OPTYPE_IABC,    // OP_DIVRK
+    OPTYPE_IABC,    // OP_MODRK
 
     OPTYPE_IAX,     // OP_INC
-    OPTYPE_I,       // OP_DEC
+    OPTYPE_IAX,     // OP_DEC
 
     OPTYPE_IAX,     // OP_CONCAT
+
+    OPTYPE_IABC,    // OP_GETBASE2
+    OPTYPE_IAX,     // OP_ADDK
+    OPTYPE_IABC,    // OP_INCLOCAL
+    OPTYPE_IABC,    // OP_EQJMP
+    OPTYPE_IABC,    // OP_LTJMP
+    OPTYPE_IABC,    // OP_GTJMP
     
     OPTYPE_I,       // OP_TRUE
     OPTYPE_I,       // OP_FALSE
@@ -282,17 +422,28 @@ typedef enum {
     GOBJECT_BOUNDCALL, // for internal vm use (connecting c functions to prototable)
     GOBJECT_CLOSURE, // for internal vm use
     GOBJECT_UPVAL, // for internal vm use
-    GOBJECT_OBJECTION // holds objections, external vm use lol
+    GOBJECT_OBJECTION, // holds objections, external vm use lol
+    GOBJECT_ROPE, // a string that hasn't been flattened yet, for internal vm use (see GObjectRope)
+    GOBJECT_MAX // not a type, just how many there are
 } GObjType;
 
+// lowercase names for GObjTypes (the gc library & heap snapshots use these)
+inline const char* getObjTypeName(int type) {
+    static const char* names[GOBJECT_MAX] = {"null", "string", "table", "prototable", "function", "cfunction", "boundcall", "closure", "upvalue", "objection", "rope"};
+    return type >= 0 && type < GOBJECT_MAX ? names[type] : "unknown";
+}
+
 // so we can refernece pointers :)
 struct GValue;
 struct GChunk;
 class GState;
 class GObjectString;
+struct GArgs;
 
 // cfunction typedef (state, args)
 typedef GValue (*GAVELCFUNC)(GState*, std::vector<GValue>&);
+// allocation-free cfunction typedef (state, args). args points directly into the stack, so nothing is copied! prefer this one
+typedef GValue (*GAVELSPANFUNC)(GState*, GArgs);
 
 /* GObjection
     Holds information on objections for both the parser and virtual machine
@@ -343,24 +494,264 @@ public:
     }
 };
 
+/* GPool
+    Size-class pool allocator for GObjects, every GIsolate has one. Sizes are rounded up to GPOOL_GRANULARITY, each size class bumps slots out of it's current 
+    page & keeps a free list of slots that were deleted. Pages are aligned to GPOOL_PAGESIZE & start with a header pointing to the pool that owns them, so an
+    object always goes back to the pool it came from, no matter which isolate is current when it's deleted. Pages are only given back when the pool is freed.
+
+    Objects too big for the pools go on the regular heap with a small GPoolLarge header in front of them. Slots are always 16 byte aligned & big objects 
+    never are (they sit 8 bytes past a 16 byte boundary), so free() can tell them apart just from the address.
+*/
+#define GPOOL_GRANULARITY 16 // slot sizes are multiples of this, which keeps every slot 16 byte aligned
+#define GPOOL_CLASSES (GPOOL_MAXSIZE / GPOOL_GRANULARITY)
+#define GPOOL_HEADERSIZE 32 // a multiple of GPOOL_GRANULARITY, so the first slot in a page is aligned too
+
+struct GPool {
+    struct GPoolSlot {
+        GPoolSlot* next;
+    };
+
+    struct GPoolClass {
+        GPoolSlot* freeList = NULL;
+        char* bump = NULL; // next unused slot in the current page
+        char* end = NULL;
+    };
+
+    // sits at the start of every page
+    struct GPoolHeader {
+        GPool* owner;
+        GPoolHeader* next;
+        size_t size; // size of the slots
+    };
+
+    // sits right in front of an object too big for the pools. 24 bytes, so the object ends up 8 bytes past a 16 byte boundary
+    struct GPoolLarge {
+        GPool* owner;
+        size_t size;
+        size_t padding;
+    };
+    static_assert(sizeof(GPoolLarge) % GPOOL_GRANULARITY != 0, "big objects have to land on an address a slot never could!");
+
+    // slots freed with release(), chained per size class so adopt() can give them all back at once
+    struct GPoolReleased {
+        GPoolSlot* heads[GPOOL_CLASSES] = {};
+        GPoolSlot* tails[GPOOL_CLASSES] = {};
+        size_t usedBytes = 0;
+        size_t largeBytes = 0;
+    };
+
+    GPoolClass classes[GPOOL_CLASSES];
+    GPoolHeader* pages = NULL; // every page we've allocated
+    size_t pageBytes = 0; // size of every page
+    size_t usedBytes = 0; // slots that are handed out
+    size_t largeBytes = 0; // objects too big for the pools
+
+    GPool() {}
+    GPool(const GPool&) = delete;
+
+    // gives the pages back. anything still in them is gone!
+    void freePages() {
+        while (pages != NULL) {
+            GPoolHeader* next = pages->next;
+            ::operator delete((void*)pages, std::align_val_t(GPOOL_PAGESIZE));
+            pages = next;
+        }
+
+        for (GPoolClass& cls : classes)
+            cls = GPoolClass();
+        pageBytes = 0;
+        usedBytes = 0;
+    }
+
+    static inline size_t getClass(size_t sz) {
+        return (sz + GPOOL_GRANULARITY - 1) / GPOOL_GRANULARITY - 1;
+    }
+
+    // how many bytes alloc(sz) really takes up
+    static inline size_t allocSize(size_t sz) {
+        if (sz > GPOOL_MAXSIZE)
+            return sizeof(GPoolLarge) + sz;
+        return (getClass(sz) + 1) * GPOOL_GRANULARITY;
+    }
+
+    static inline GPoolHeader* getPage(void* ptr) {
+        return (GPoolHeader*)((uintptr_t)ptr & ~(uintptr_t)(GPOOL_PAGESIZE - 1));
+    }
+
+    static inline bool isLarge(void* ptr) {
+        return ((uintptr_t)ptr & (GPOOL_GRANULARITY - 1)) != 0;
+    }
+
+    static inline GPoolLarge* getLarge(void* ptr) {
+        return (GPoolLarge*)ptr - 1;
+    }
+
+    static inline void freeLarge(GPoolLarge* large) {
+        ::operator delete((void*)large, std::align_val_t(GPOOL_GRANULARITY));
+    }
+
+    inline void* alloc(size_t sz) {
+        if (sz > GPOOL_MAXSIZE) {
+            largeBytes += sz;
+            GPoolLarge* large = (GPoolLarge*)::operator new(sizeof(GPoolLarge) + sz, std::align_val_t(GPOOL_GRANULARITY));
+            large->owner = this;
+            large->size = sz;
+            return large + 1;
+        }
+
+        size_t indx = getClass(sz);
+        GPoolClass& cls = classes[indx];
+        usedBytes += (indx + 1) * GPOOL_GRANULARITY;
+
+        // reuse a freed slot first
+        if (cls.freeList != NULL) {
+            GPoolSlot* slot = cls.freeList;
+            cls.freeList = slot->next;
+            return slot;
+        }
+
+        size_t slotSize = (indx + 1) * GPOOL_GRANULARITY;
+        if (cls.bump + slotSize > cls.end) {
+            // grab a new page
+            GPoolHeader* page = (GPoolHeader*)::operator new(GPOOL_PAGESIZE, std::align_val_t(GPOOL_PAGESIZE));
+            page->owner = this;
+            page->next = pages;
+            page->size = slotSize;
+            pages = page;
+            pageBytes += GPOOL_PAGESIZE;
+            cls.bump = (char*)page + GPOOL_HEADERSIZE;
+            cls.end = (char*)page + GPOOL_PAGESIZE;
+        }
+
+        void* slot = cls.bump;
+        cls.bump += slotSize;
+        return slot;
+    }
+
+    // the size comes from the page header, so variable sized objects (like GObjectString) can be freed without knowing how big they were
+    static inline void free(void* ptr) {
+        if (isLarge(ptr)) {
+            GPoolLarge* large = getLarge(ptr);
+            large->owner->largeBytes -= large->size;
+            freeLarge(large);
+            return;
+        }
+
+        // find the page (& the pool that owns it) from the address
+        GPoolHeader* page = getPage(ptr);
+        GPool* pool = page->owner;
+
+        size_t indx = getClass(page->size);
+        GPoolSlot* slot = reinterpret_cast<GPoolSlot*>(ptr);
+        GPoolClass& cls = pool->classes[indx];
+        pool->usedBytes -= page->size;
+        slot->next = cls.freeList;
+        cls.freeList = slot;
+    }
+
+    /* release(ptr, released)
+        Frees the slot of an object that was already destroyed, without touching the pool. (so it's safe while the pool is used on another thread.) The slot 
+    can't be reused until it's handed back with adopt().
+    */
+    static inline void release(void* ptr, GPoolReleased& released) {
+        if (isLarge(ptr)) {
+            GPoolLarge* large = getLarge(ptr);
+            released.largeBytes += large->size;
+            freeLarge(large);
+            return;
+        }
+
+        GPoolHeader* page = getPage(ptr);
+
+        size_t indx = getClass(page->size);
+        GPoolSlot* slot = reinterpret_cast<GPoolSlot*>(ptr);
+        slot->next = released.heads[indx];
+        released.heads[indx] = slot;
+        if (released.tails[indx] == NULL)
+            released.tails[indx] = slot;
+        released.usedBytes += page->size;
+    }
+
+    // puts slots freed by release() back on our free lists
+    void adopt(GPoolReleased& released) {
+        for (size_t i = 0; i < GPOOL_CLASSES; i++) {
+            if (released.heads[i] == NULL)
+                continue;
+
+            released.tails[i]->next = classes[i].freeList;
+            classes[i].freeList = released.heads[i];
+        }
+
+        usedBytes -= released.usedBytes;
+        largeBytes -= released.largeBytes;
+        released = GPoolReleased();
+    }
+};
+
+// bytes a std::string owns outside of itself (0 if it fits in the small string buffer)
+inline size_t getStringHeapSize(const std::string& str) {
+    const char* data = str.data();
+    if (data >= reinterpret_cast<const char*>(&str) && data < reinterpret_cast<const char*>(&str + 1))
+        return 0;
+    return str.capacity() + 1;
+}
+
+/* formatNumber(num, buf)
+    Writes num into buf (which needs room for GNUMBER_MAXCHARS characters) & returns how many characters it wrote, buf is NOT '\0' terminated! Whole 
+numbers are written as integers, everything else goes through std::to_chars, which prints the same thing as printf("%.14g") (or the shortest round-trip 
+string if GAVEL_SHORTESTNUMBERS is defined) without parsing a format string or looking at the locale.
+*/
+inline int formatNumber(double num, char* buf) {
+    // %.14g only switches to an exponent past 14 digits, so anything smaller is just the integer. (-0 goes the slow way so it keeps it's sign)
+    if (num > -1e14 && num < 1e14) {
+        int64_t i = (int64_t)num;
+        if ((double)i == num && (i != 0 || !std::signbit(num)))
+            return std::to_chars(buf, buf + GNUMBER_MAXCHARS, i).ptr - buf;
+    }
+
+#ifdef GAVEL_SHORTESTNUMBERS
+    return std::to_chars(buf, buf + GNUMBER_MAXCHARS, num).ptr - buf;
+#else
+    return std::to_chars(buf, buf + GNUMBER_MAXCHARS, num, std::chars_format::general, 14).ptr - buf;
+#endif
+}
+
 /* GObjects
     This class is a baseclass for all GValue objects.
 */
 class GObject {
 public:
     GObjType type = GOBJECT_NULL;
-    bool isGray = false; // for our garbage collector
+    std::atomic<bool> marked{false}; // for our garbage collector, set while it's grey or black. atomic so the parallel marker can claim objects (see Gavel::markObject)
+    bool isOld = false; // survived a collection, minor collections don't trace or sweep these
+    bool isRemembered = false; // in the remembered set (see Gavel::writeBarrier)
     GObject* next = NULL; // linked list for our garbage collector as well :)
+    size_t gcSize = 0; // how many bytes this object is counted as in Gavel::bytesAllocated, 0 if the GC doesn't own it (see Gavel::resizeObject)
 
     GObject() {}
     virtual ~GObject() {}
 
+    // the mark bit is only ever raced on by the parallel marker (which uses tryMark), so the rest of the GC can use relaxed loads & stores
+    inline bool isMarked() const { return marked.load(std::memory_order_relaxed); }
+    inline void setMarked(bool m) { marked.store(m, std::memory_order_relaxed); }
+
+    // sets the mark bit, returns true if we're the one that set it
+    inline bool tryMark() {
+        return !marked.load(std::memory_order_relaxed) && !marked.exchange(true, std::memory_order_acq_rel);
+    }
+
+#ifndef GAVEL_NO_POOL
+    // every GObject comes out of the current isolate's pool. the pool page knows the slot size, so delete doesn't need it
+    static void* operator new(size_t sz);
+    static void operator delete(void* ptr) { GPool::free(ptr); }
+#endif
+
     virtual bool equals(GObject*) { return false; };
     virtual std::string toString() { return ""; };
     virtual std::string toStringDataType() { return ""; };
     virtual GObject* clone() {return new GObject(); };
     virtual int getHash() {return std::hash<GObjType>()(type); };
-    virtual size_t getSize() { return sizeof(GObject); }; // return the size of a GObject in bytes
+    virtual size_t getSize() { return sizeof(GObject); }; // return the size of a GObject in bytes, including anything it owns (strings, arrays, etc.)
 
     // so we can easily compare GValues
     bool operator==(GObject& other)
@@ -371,7 +762,8 @@ public:
 
 class GObjectCFunction : public GObject {
 public:
-    GAVELCFUNC val;
+    GAVELCFUNC val = NULL;
+    GAVELSPANFUNC spanVal = NULL; // only one of these is ever set
     int hash;
 
     GObjectCFunction(GAVELCFUNC b):
@@ -381,11 +773,18 @@ public:
         hash = std::hash<GObjType>()(GOBJECT_CFUNCTION);
     }
 
+    GObjectCFunction(GAVELSPANFUNC b):
+        spanVal(b) {
+        type = GOBJECT_CFUNCTION;
+        hash = std::hash<GObjType>()(GOBJECT_CFUNCTION);
+    }
+
     virtual ~GObjectCFunction() {};
 
     bool equals(GObject* other) {
         if (other->type == type) {
-            return reinterpret_cast<GObjectCFunction*>(other)->val == val;
+            GObjectCFunction* func = reinterpret_cast<GObjectCFunction*>(other);
+            return func->val == val && func->spanVal == spanVal;
         }
         return false;
     }
@@ -401,6 +800,8 @@ public:
     }
 
     GObject* clone() {
+        if (spanVal != NULL)
+            return new GObjectCFunction(spanVal);
         return new GObjectCFunction(val);
     }
 
@@ -442,12 +843,105 @@ public:
     }
 
     size_t getSize() { 
-        return sizeof(GObjectObjection); 
+        return sizeof(GObjectObjection) + getStringHeapSize(val.getString()); 
     };
 };
 
+/* 
+    GValue layouts & accessors. ALWAYS use these macros instead of touching GValue's members, the members depend on GAVEL_NANBOXING!
+
+    NaN-boxed layout (64 bits):
+        - numbers   : any double that isn't our quiet NaN pattern
+        - nil       : QNAN | 1
+        - booleans  : QNAN | 2 (false), QNAN | 3 (true)
+        - characters: QNAN | TAGCHAR | character
+        - objects   : SIGN | QNAN | 48 bit pointer
+*/
+#ifdef GAVEL_NANBOXING
+
+#define NANBOX_SIGN             ((uint64_t)0x8000000000000000)
+#define NANBOX_QNAN             ((uint64_t)0x7ffc000000000000)
+#define NANBOX_CANONNAN         ((uint64_t)0x7ff8000000000000) // the only NaN numbers are stored as, any other could look like a tagged value
+#define NANBOX_TAGCHAR          ((uint64_t)0x0001000000000000)
+#define NANBOX_NIL              (NANBOX_QNAN | 1)
+#define NANBOX_FALSE            (NANBOX_QNAN | 2)
+#define NANBOX_TRUE             (NANBOX_QNAN | 3)
+
+#define GETGVALUETYPE(x)        (x).getType()
+
+#define READGVALUEBOOL(x)       ((x).bits == NANBOX_TRUE)
+#define READGVALUENUMBER(x)     (x).asNumber()
+#define READGVALUECHARACTER(x)  ((char)((x).bits & 0xFF))
+#define READGVALUEOBJ(x)        ((GObject*)(uintptr_t)((x).bits & ~(NANBOX_SIGN | NANBOX_QNAN)))
+
+#define ISGVALUEBOOL(x)         (((x).bits | 1) == NANBOX_TRUE)
+#define ISGVALUENUMBER(x)       (((x).bits & NANBOX_QNAN) != NANBOX_QNAN)
+#define ISGVALUECHARACTER(x)    (((x).bits & (NANBOX_SIGN | NANBOX_QNAN | NANBOX_TAGCHAR)) == (NANBOX_QNAN | NANBOX_TAGCHAR))
+#define ISGVALUENIL(x)          ((x).bits == NANBOX_NIL)
+#define ISGVALUEOBJ(x)          (((x).bits & (NANBOX_SIGN | NANBOX_QNAN)) == (NANBOX_SIGN | NANBOX_QNAN))
+
+#else
+
+#define GETGVALUETYPE(x)        (x).type
+
+#define READGVALUEBOOL(x)       (x).val.boolean
+#define READGVALUENUMBER(x)     (x).val.number
+#define READGVALUECHARACTER(x)  (x).val.character
+#define READGVALUEOBJ(x)        (x).val.obj
+
+#define ISGVALUEBOOL(x)         ((x).type == GAVEL_TBOOLEAN)
+#define ISGVALUENUMBER(x)       ((x).type == GAVEL_TNUMBER)
+#define ISGVALUECHARACTER(x)    ((x).type == GAVEL_TCHAR)
+#define ISGVALUENIL(x)          ((x).type == GAVEL_TNIL)
+#define ISGVALUEOBJ(x)          ((x).type == GAVEL_TOBJ)
+
+#endif
+
 // holds primitives
 struct GValue {
+#ifdef GAVEL_NANBOXING
+    uint64_t bits;
+
+    GValue(): bits(NANBOX_NIL) {}
+    GValue(bool b): bits(b ? NANBOX_TRUE : NANBOX_FALSE) {}
+    GValue(char c): bits(NANBOX_QNAN | NANBOX_TAGCHAR | (uint8_t)c) {}
+    GValue(GObject* o): bits(NANBOX_SIGN | NANBOX_QNAN | (uint64_t)(uintptr_t)o) {}
+
+    GValue(double n) {
+        if (n != n) // NaNs can carry any payload (scripts can make them with tonumber), make sure it doesn't decode as something else
+            bits = NANBOX_CANONNAN;
+        else
+            memcpy(&bits, &n, sizeof(double));
+    }
+
+    inline double asNumber() {
+        double n;
+        memcpy(&n, &bits, sizeof(double));
+        return n;
+    }
+
+    GType getType() {
+        if (ISGVALUENUMBER(*this))
+            return GAVEL_TNUMBER;
+        if (ISGVALUEOBJ(*this))
+            return GAVEL_TOBJ;
+        if (ISGVALUEBOOL(*this))
+            return GAVEL_TBOOLEAN;
+        if (ISGVALUECHARACTER(*this))
+            return GAVEL_TCHAR;
+        return GAVEL_TNIL;
+    }
+
+    bool equals(GValue v) {
+        if (ISGVALUENUMBER(*this) && ISGVALUENUMBER(v)) // NaN != NaN, 0 == -0
+            return asNumber() == v.asNumber();
+        if (bits == v.bits) // same object, or same primitive
+            return true;
+        if (ISGVALUEOBJ(*this) && ISGVALUEOBJ(v))
+            return READGVALUEOBJ(v)->equals(READGVALUEOBJ(*this));
+        return false;
+    }
+#else
     GType type;
     union {
         bool boolean;
@@ -494,14 +988,15 @@ struct GValue {
             case GAVEL_TCHAR:
                 return v.val.character == val.character;
             case GAVEL_TOBJ:
-                return v.val.obj->equals(val.obj);
+                return v.val.obj == val.obj || v.val.obj->equals(val.obj);
             default:
                 return false;
         }
     }
+#endif
 
     std::string toStringDataType() {
-        switch (type) {
+        switch (GETGVALUETYPE(*this)) {
             case GAVEL_TNIL:
                 return "[NIL]";
             case GAVEL_TBOOLEAN:
@@ -511,25 +1006,24 @@ struct GValue {
             case GAVEL_TCHAR:
                 return "[CHAR]";
             case GAVEL_TOBJ:
-                return val.obj->toStringDataType();
+                return READGVALUEOBJ(*this)->toStringDataType();
             default:
                 return "[ERR]";
         }
     }
     
     std::string toString() {
-        switch (type) {
+        switch (GETGVALUETYPE(*this)) {
             case GAVEL_TBOOLEAN:
-                return val.boolean ? "True" : "False";
+                return READGVALUEBOOL(*this) ? "True" : "False";
             case GAVEL_TNUMBER: {
-                char s[32]; // hmmmmm this seems fine for now;
-                sprintf(s, "%.14g", val.number);
-                return std::string(s);
+                char s[GNUMBER_MAXCHARS];
+                return std::string(s, formatNumber(READGVALUENUMBER(*this), s));
             }
             case GAVEL_TCHAR: 
-                return std::string(1, val.character);
+                return std::string(1, READGVALUECHARACTER(*this));
             case GAVEL_TOBJ: 
-                return val.obj->toString();
+                return READGVALUEOBJ(*this)->toString();
             case GAVEL_TNIL:
             default:
                 return "Nil";
@@ -537,15 +1031,16 @@ struct GValue {
     }
 
     int getHash() {
+        GType type = GETGVALUETYPE(*this);
         switch (type) {
             case GAVEL_TBOOLEAN:
-                return std::hash<GType>()(type) ^ std::hash<bool>()(val.boolean);
+                return std::hash<GType>()(type) ^ std::hash<bool>()(READGVALUEBOOL(*this));
             case GAVEL_TNUMBER: 
-                return std::hash<GType>()(type) ^ std::hash<double>()(val.number);
+                return std::hash<GType>()(type) ^ std::hash<double>()(READGVALUENUMBER(*this));
             case GAVEL_TCHAR:
-                return std::hash<GType>()(type) ^ std::hash<double>()(val.character);
+                return std::hash<GType>()(type) ^ std::hash<double>()(READGVALUECHARACTER(*this));
             case GAVEL_TOBJ:
-                return val.obj->getHash();
+                return READGVALUEOBJ(*this)->getHash();
             case GAVEL_TNIL:
             default:
                 return std::hash<GType>()(type);
@@ -553,6 +1048,34 @@ struct GValue {
     }
 };
 
+#ifdef GAVEL_NANBOXING
+static_assert(sizeof(void*) == 8 && sizeof(GValue) == 8, "GAVEL_NANBOXING requires 64bit pointers!");
+#endif
+
+/* GArgs
+    View of the arguments passed to a GAVELSPANFUNC, they're still sitting on the GStack. Works with range-based for loops too :)
+*/
+struct GArgs {
+    GValue* args;
+    int count;
+
+    inline int size() const {
+        return count;
+    }
+
+    inline GValue& operator[](int i) {
+        return args[i];
+    }
+
+    inline GValue* begin() {
+        return args;
+    }
+
+    inline GValue* end() {
+        return args + count;
+    }
+};
+
 #define CREATECONST_NIL()       GValue()
 #define CREATECONST_BOOL(b)     GValue((bool)(b))
 #define CREATECONST_NUMBER(n)   GValue((double)(n))
@@ -565,26 +1088,17 @@ struct GValue {
 
 #define READOBJECTVALUE(x, type)reinterpret_cast<type>(x)->val
 
-#define READGVALUEBOOL(x)       x.val.boolean
-#define READGVALUENUMBER(x)     x.val.number
-#define READGVALUECHARACTER(x)  x.val.character
-#define READGVALUESTRING(x)     READOBJECTVALUE(x.val.obj, GObjectString*)
-#define READGVALUEFUNCTION(x)   READOBJECTVALUE(x.val.obj, GObjectFunction*)
-#define READGVALUECFUNCTION(x)  READOBJECTVALUE(x.val.obj, GObjectCFunction*)
-#define READGVALUECLOSURE(x)    READOBJECTVALUE(x.val.obj, GObjectClosure*)
-#define READGVALUEOBJECTION(x)  READOBJECTVALUE(x.val.obj, GObjectObjection*)
-#define READGVALUETABLE(x)      READOBJECTVALUE(x.val.obj, GObjectTable*)
-#define READGVALUEPROTOTABLE(x) READOBJECTVALUE(x.val.obj, GObjectPrototable*)
-
-#define ISGVALUEBOOL(x)         (x.type == GAVEL_TBOOLEAN)
-#define ISGVALUENUMBER(x)       (x.type == GAVEL_TNUMBER)
-#define ISGVALUECHARACTER(x)    (x.type == GAVEL_TCHAR)
-#define ISGVALUENIL(x)          (x.type == GAVEL_TNIL)
-#define ISGVALUEOBJ(x)          (x.type == GAVEL_TOBJ)
+#define READGVALUESTRING(x)     reinterpret_cast<GObjectString*>(READGVALUEOBJ(x))->str()
+#define READGVALUEFUNCTION(x)   READOBJECTVALUE(READGVALUEOBJ(x), GObjectFunction*)
+#define READGVALUECFUNCTION(x)  READOBJECTVALUE(READGVALUEOBJ(x), GObjectCFunction*)
+#define READGVALUECLOSURE(x)    READOBJECTVALUE(READGVALUEOBJ(x), GObjectClosure*)
+#define READGVALUEOBJECTION(x)  READOBJECTVALUE(READGVALUEOBJ(x), GObjectObjection*)
+#define READGVALUETABLE(x)      READOBJECTVALUE(READGVALUEOBJ(x), GObjectTable*)
+#define READGVALUEPROTOTABLE(x) READOBJECTVALUE(READGVALUEOBJ(x), GObjectPrototable*)
 
 // treat this like a macro, this is to protect against macro expansion and causing undefined behavior :eyes:
 inline bool ISGVALUEOBJTYPE(GValue v, GObjType t) {
-    return ISGVALUEOBJ(v) && v.val.obj->type == t;
+    return ISGVALUEOBJ(v) && READGVALUEOBJ(v)->type == t;
 }
 
 #define ISGVALUESTRING(x)       ISGVALUEOBJTYPE(x, GOBJECT_STRING)
@@ -595,13 +1109,14 @@ inline bool ISGVALUEOBJTYPE(GValue v, GObjType t) {
 #define ISGVALUEOBJECTION(x)    ISGVALUEOBJTYPE(x, GOBJECT_OBJECTION)
 #define ISGVALUETABLE(x)        ISGVALUEOBJTYPE(x, GOBJECT_TABLE)
 #define ISGVALUEPROTOTABLE(x)   ISGVALUEOBJTYPE(x, GOBJECT_PROTOTABLE)
+#define ISGVALUEROPE(x)         ISGVALUEOBJTYPE(x, GOBJECT_ROPE)
 // again. protecting against macro-expansion
 inline bool ISGVALUEBASETABLE(GValue v) {
-    return (ISGVALUETABLE(v) || ISGVALUEPROTOTABLE(v) || ISGVALUESTRING(v));
+    return (ISGVALUETABLE(v) || ISGVALUEPROTOTABLE(v) || ISGVALUESTRING(v) || ISGVALUEROPE(v));
 }
 
 // internal vm use
-#define FREEGVALUEOBJ(x)        delete x.val.obj
+#define FREEGVALUEOBJ(x)        delete READGVALUEOBJ(x)
 
 class GObjectUpvalue : public GObject {
 public:
@@ -650,135 +1165,527 @@ public:
 /*  GTable
         This is GavelScript's custom hashtable implementation. This is so we can use string interning, which is a lowlevel optimization where we can shorten comparison times by just comparing the 
     pointers and not comparing the actual memory contents. (can be enabled/disabled using GSTRING_INTERN)
+
+        It's a flat open-addressing table using Robin Hood hashing, so no allocation per insert & lookups just walk a contiguous array. Every node remembers how far it is from 
+    it's ideal slot (dist), inserts steal slots from nodes that are closer to home than they are, which keeps probe lengths short. A lookup can stop as soon as it runs into a
+    node that's closer to home than we would be, so misses are cheap too. Deletes shift the following nodes back instead of leaving tombstones.
 */
 template<typename T>
 class GTable {
-private:
-    struct Entry {
-        T key; // dynamically allocated, also may point to the same string due to string interning
+public:
+    struct Node {
+        T key;
+        GValue val;
+        uint32_t hash = 0;
+        uint32_t dist = 0; // distance from our ideal slot + 1. 0 means the slot is empty
+    };
 
-        Entry(T k):
-            key(k) {}
+    // walks every used node, skipping the empty ones
+    class iterator {
+    private:
+        Node* node;
+        Node* last;
 
-        bool operator == (const Entry& other) const {
-            if constexpr (std::is_same<T, GObjectString*>()) {
-                #ifdef GSTRING_INTERN
-                            return key == other.key;
-                #else
-                            return key->equals(other.key);
-                #endif
-            } else if constexpr (std::is_same<T, GObject*>()) {
-                return key->equals(other.key);
-            } else if constexpr (std::is_same<T, GValue>()) {
-                return ((GValue)key).equals(other.key);
-            }
+        void skipEmpty() {
+            while (node != last && node->dist == 0)
+                node++;
+        }
+    public:
+        iterator(Node* n, Node* l): node(n), last(l) {
+            skipEmpty();
         }
+
+        Node& operator*() { return *node; }
+        Node* operator->() { return node; }
+
+        iterator& operator++() {
+            node++;
+            skipEmpty();
+            return *this;
+        }
+
+        bool operator!=(const iterator& other) const { return node != other.node; }
+        bool operator==(const iterator& other) const { return node == other.node; }
     };
 
-    struct hash_fn {
-        std::size_t operator() (Entry v) const {
-            if constexpr (std::is_same<T, GObjectString*>() || std::is_same<T, GObject*>()) {
-                return v.key->getHash();
-            } else if constexpr (std::is_same<T, GValue>()) {
-                return v.key.getHash();
+private:
+    Node* nodes = NULL;
+    uint32_t capacity = 0; // always a power of 2 (or 0)
+    int count = 0;
+
+    // scramble the bits, since we only use the lower bits to find the slot
+    static inline uint32_t mixHash(uint32_t h) {
+        h ^= h >> 16;
+        h *= 0x45d9f3b;
+        h ^= h >> 16;
+        return h;
+    }
+
+    static inline uint32_t hashKey(T key) {
+        if constexpr (std::is_same<T, GValue>()) {
+            return mixHash(key.getHash());
+        } else {
+            return mixHash(key->getHash());
+        }
+    }
+
+    static inline bool keysEqual(T a, T b) {
+        if constexpr (std::is_same<T, GObjectString*>()) {
+            #ifdef GSTRING_INTERN
+                        return a == b;
+            #else
+                        return a->equals(b);
+            #endif
+        } else if constexpr (std::is_same<T, GValue>()) {
+            return a.equals(b);
+        } else {
+            return a->equals(b);
+        }
+    }
+
+    // returns the index of the node holding key, or -1 if it doesn't exist
+    int findSlot(T key, uint32_t hash) {
+        if (count == 0)
+            return -1;
+
+        uint32_t mask = capacity - 1;
+        uint32_t i = hash & mask;
+        for (uint32_t dist = 1;; dist++) {
+            Node& node = nodes[i];
+            // empty, or a node that's closer to home than we would be. either way, key isn't here
+            if (node.dist < dist)
+                return -1;
+
+            if (node.hash == hash && keysEqual(node.key, key))
+                return i;
+
+            i = (i + 1) & mask;
+        }
+    }
+
+    // inserts a node, assumes the key doesn't already exist & there's room
+    void insertNode(Node node) {
+        uint32_t mask = capacity - 1;
+        uint32_t i = node.hash & mask;
+        node.dist = 1;
+        while (true) {
+            Node& slot = nodes[i];
+            if (slot.dist == 0) {
+                slot = node;
+                count++;
+                return;
             }
+
+            // take from the rich, give to the poor
+            if (slot.dist < node.dist)
+                std::swap(slot, node);
+
+            i = (i + 1) & mask;
+            node.dist++;
         }
-    };
+    }
+
+    void resize(uint32_t newCapacity) {
+        Node* oldNodes = nodes;
+        uint32_t oldCapacity = capacity;
+
+        nodes = new Node[newCapacity];
+        capacity = newCapacity;
+        count = 0;
+
+        for (uint32_t i = 0; i < oldCapacity; i++) {
+            if (oldNodes[i].dist != 0)
+                insertNode(oldNodes[i]);
+        }
+
+        delete[] oldNodes;
+    }
+
+    // removes the node at i, shifting the nodes after it back a slot
+    void eraseSlot(uint32_t i) {
+        uint32_t mask = capacity - 1;
+        uint32_t next = (i + 1) & mask;
+        while (nodes[next].dist > 1) {
+            nodes[i] = nodes[next];
+            nodes[i].dist--;
+            i = next;
+            next = (next + 1) & mask;
+        }
+
+        nodes[i] = Node(); // clears it
+        count--;
+    }
+
+    void insert(T key, uint32_t hash, GValue value) {
+        // keep the load factor under 75%
+        if ((uint32_t)(count + 1) * 4 > capacity * 3)
+            resize(capacity == 0 ? 8 : capacity * 2);
 
+        Node node;
+        node.key = key;
+        node.val = value;
+        node.hash = hash;
+        insertNode(node);
+    }
 
 public:
-    std::unordered_map<Entry, GValue, hash_fn> hashTable;
     GTable() {}
 
-    T findExistingKey(T key) {
-        // this is why hashes need to be *pretty* unique! however hash collisions will always exist so if the hash matches, compare the memory anyways
-        for (std::pair<Entry, GValue> pair : hashTable) {
-            if (pair.first.key->getHash() == key->getHash())
-                return pair.first.key;
-        }
+    GTable(const GTable& other) {
+        *this = other;
+    }
+
+    GTable& operator=(const GTable& other) {
+        if (this == &other)
+            return *this;
+
+        delete[] nodes;
+        nodes = other.capacity == 0 ? NULL : new Node[other.capacity];
+        capacity = other.capacity;
+        count = other.count;
+        for (uint32_t i = 0; i < capacity; i++)
+            nodes[i] = other.nodes[i];
+        return *this;
+    }
+
+    ~GTable() {
+        delete[] nodes;
+    }
+
+    iterator begin() {
+        return iterator(nodes, nodes + capacity);
+    }
+
+    iterator end() {
+        return iterator(nodes + capacity, nodes + capacity);
+    }
+
+    // nodes can be walked by index too (use getCapacity()), empty nodes have a dist of 0. this is safe to use while the table is being modified
+    uint32_t getCapacity() {
+        return capacity;
+    }
+
+    Node& getNode(uint32_t i) {
+        return nodes[i];
+    }
 
-        return NULL;
+    /* findString(str, strHash)
+        Only for GTable<GObjectString*>! Looks up a string key by it's contents (strHash is GObjectString::hashString(str)), so the intern set doesn't 
+    need to allocate a GObjectString just to see if it already exists. returns NULL if it doesn't
+    */
+    T findString(std::string_view str, int strHash) {
+        if (count == 0)
+            return NULL;
+
+        uint32_t hash = mixHash(strHash);
+        uint32_t mask = capacity - 1;
+        uint32_t i = hash & mask;
+        for (uint32_t dist = 1;; dist++) {
+            Node& node = nodes[i];
+            if (node.dist < dist)
+                return NULL;
+
+            if (node.hash == hash && node.key->str() == str)
+                return node.key;
+
+            i = (i + 1) & mask;
+        }
     }
 
     bool checkValidKey(T key) {
-        return hashTable.find(key) != hashTable.end();
+        return findSlot(key, hashKey(key)) != -1;
     }
     
     GValue getIndex(T key) {
         // if key exists, return it
-        auto res = hashTable.find(key);
-        if (res != hashTable.end()) {
-            return res->second;
-        }
+        int i = findSlot(key, hashKey(key));
+        if (i != -1)
+            return nodes[i].val;
 
         // otherwise return NIL
         return CREATECONST_NIL();
     }
 
+    // returns true if index exists, and copies it's value to out
+    bool checkGetIndex(T key, GValue& out) {
+        int i = findSlot(key, hashKey(key));
+        if (i == -1)
+            return false;
+
+        out = nodes[i].val;
+        return true;
+    }
+
     void setIndex(T key, GValue value) {
-        hashTable[key] = value;
+        checkSetIndex(key, value);
     }
 
     // returns true if index already existed
     bool checkSetIndex(T key, GValue v) {
-        auto res = hashTable.find(key);
-        if (res != hashTable.end()) {
-            res->second = v;
+        uint32_t hash = hashKey(key);
+        int i = findSlot(key, hash);
+        if (i != -1) {
+            nodes[i].val = v;
             return true;
         }
 
-        hashTable[key] = v;
+        insert(key, hash, v);
         return false;
     }
 
     std::vector<T> getVectorOfKeys() {
         std::vector<T> keys;
-        for (std::pair<Entry, GValue> pair : hashTable) {
-            keys.push_back(pair.first.key);
+        for (Node& node : *this) {
+            keys.push_back(node.key);
         }
         return keys;
     }
 
-    auto deleteKey(T key) {
-        return hashTable.erase(key);
+    // returns the number of removed keys (0 or 1)
+    int deleteKey(T key) {
+        int i = findSlot(key, hashKey(key));
+        if (i == -1)
+            return 0;
+
+        eraseSlot(i);
+        return 1;
+    }
+
+    // removes every node that remove(node) returns true for
+    template <typename F>
+    void removeIf(F remove) {
+        uint32_t i = 0;
+        while (i < capacity) {
+            // eraseSlot() shifts the next node into i, so check i again
+            if (nodes[i].dist != 0 && remove(nodes[i]))
+                eraseSlot(i);
+            else
+                i++;
+        }
     }
 
     int getSize() {
-        return hashTable.size();
+        return count;
+    }
+
+    // bytes allocated for the nodes
+    size_t getMemory() {
+        return (size_t)capacity * sizeof(Node);
     }
 
     void printTable() {
-        for (std::pair<Entry, GValue> pair : hashTable) {
-            std::cout << pair.first.key->toString() << " : " << pair.second.toString() << std::endl;
+        for (Node& node : *this) {
+            std::cout << node.key->toString() << " : " << node.val.toString() << std::endl;
         }
     }
 };
 
 namespace Gavel {
-    GObjectString* addString(std::string str);
-    GState* newState();
+    GObjectString* addString(std::string_view str);
     void freeState(GState*);
     GChunk* newChunk();
     void freeChunk(GChunk* ch);
-    void checkGarbage();
+    bool checkGarbage();
+    bool reserveMemory(size_t bytes);
     void collectGarbage();
+    void collectYoung();
     void addGarbage(GObject* g);
-
+    void resizeObject(GObject* g, size_t newSize);
+    void resizeBuffer(size_t& counted, size_t newSize);
+    void rememberObject(GObject* o);
+    void regrayObject(GObject* o);
     void markObject(GObject* o);
-    void markValue(GValue val);
 
-    template <typename T>
-    void markTable(GTable<T>* tbl);
+    // where the current full collection is at. during GC_MARK objects that are marked (isMarked) are either grey or black, so the write barrier has to keep black 
+    // objects from pointing to white ones. (new objects are white, the roots are marked again before sweeping so the ones that are alive are found then.)
+    typedef enum {
+        GC_IDLE,
+        GC_MARK,
+        GC_SWEEP
+    } GCPhase;
+
+    // what the GC has been up to, see Gavel::getGCStats(). pauses are in microseconds & only count time the mutator was stopped (the background sweeper isn't)
+    struct GGCStats {
+        size_t collections = 0; // full collections finished
+        size_t minorCollections = 0;
+        size_t pauses = 0; // how many times the GC stopped the mutator to do work (minor collections, slices of full ones, collectGarbage)
+        double totalPause = 0;
+        double longestPause = 0;
+        size_t lastFreed = 0; // bytes freed by the last full collection (& minor collections that ran while it was sweeping)
+        size_t totalFreed = 0; // bytes freed by every collection
+        size_t liveBytes = 0; // bytes that survived the last full collection
+        size_t objects[GOBJECT_MAX] = {}; // GObjects the GC is tracking, by GObjType
+    };
 
-    template <typename T>
-    inline GValue newGValue(T x);
+    /* GIsolate
+        Everything the GC tracks lives in an isolate: the objects (& the pool they're allocated from), the intern set, the states & the chunks. Each thread has 
+    a current isolate (see setIsolate), that's where new objects & strings go. States switch to their own isolate while they run. Isolates don't share anything, 
+    so states in different isolates can run on different threads at the same time. A state, the functions it runs & every value it touches have to come from
+    the same isolate though, so compile scripts with the state's isolate current!
+    */
+    struct GIsolate {
+        GTable<GObjectString*> strings;
+        std::vector<GObject*> greyObjects; // objects that are marked grey
+        GObject* objList = NULL; // another linked list to track our allocated objects on the heap (the old generation)
+        GObject* youngList = NULL; // objects allocated since the last collection (the nursery)
+        std::vector<GObject*> rememberedSet; // young objects old objects point to, and old objects that need to be re-traced (see writeBarrier)
+        GState* states = NULL;
+        GChunk* chunks = NULL;
+        size_t bytesAllocated = 0;
+        size_t youngBytes = 0; // bytes in the nursery, already counted in bytesAllocated
+        size_t nextGc = GC_MINTHRESHOLD;
+        size_t minThreshold = GC_MINTHRESHOLD;
+        size_t growth = GC_GROWTH; // percent
+        size_t nurserySize = GC_NURSERYSIZE;
+        size_t memoryLimit = GC_MEMORYLIMIT; // 0 for no limit
+        bool generational = true; // if false, every collection is a full one
+        bool minorCollection = false; // markObject skips old objects while this is set
+        GObject* sweepList = NULL; // objects the current full collection hasn't swept yet
+        size_t gcDebt = 0; // bytes allocated since the last slice of the current full collection
+        size_t maxPause = GC_MAXPAUSE; // in microseconds
+        GCPhase gcPhase = GC_IDLE;
+        GGCStats stats;
+        size_t freedAtStart = 0; // stats.totalFreed when the current full collection started
+#ifndef GAVEL_NO_POOL
+        GPool pool;
+#endif
 
-    void blackenObject(GObject* obj);
-    void traceReferences();
-    void markStates();
+#ifndef GAVEL_NO_GCTHREADS
+        // the background sweeper, it owns sweepList while it's running. everything it frees is handed back in finishBackgroundSweep()
+        bool backgroundSweep = GC_BACKGROUNDSWEEP;
+        std::thread sweeper;
+        std::atomic<bool> sweepDone{false};
+        GObject* sweptSurvivors = NULL; // unmarked & ready to go back in objList
+        GObject* sweptSurvivorsTail = NULL;
+        GObject* sweptDeferred = NULL; // dead, but their destructors aren't safe off of our thread (functions free their chunk)
+        size_t sweptBytes = 0;
+        size_t sweptObjects[GOBJECT_MAX] = {};
+#ifndef GAVEL_NO_POOL
+        GPool::GPoolReleased sweptSlots;
+#endif
+
+        ~GIsolate() {
+            if (sweeper.joinable())
+                sweeper.join();
+        }
+#endif
+    };
+
+    static GIsolate defaultIsolate; // for threads that never picked one
+    static thread_local GIsolate* isolate = &defaultIsolate; // the current isolate of this thread
+
+    GIsolate* newIsolate();
+    void freeIsolate(GIsolate* iso);
+    void setIsolate(GIsolate* iso);
+    GIsolate* getIsolate();
+    GState* newState(GIsolate* iso = NULL);
+
+    // makes iso the current isolate until this goes out of scope
+    struct GIsolateScope {
+        GIsolate* last;
+
+        GIsolateScope(GIsolate* iso): last(isolate) {
+            isolate = iso;
+        }
+
+        ~GIsolateScope() {
+            isolate = last;
+        }
+    };
+
+#ifndef GAVEL_NO_GCTHREADS
+    /* GMarker
+        The parallel marker. Helper threads are shared by the whole process, an isolate that's collecting borrows them (if another one is using them, it
+    just marks on it's own). Everyone marking has a GMarkWorker, grey objects go on it's private stack & when someone runs out of work, the others move half
+    of their stack to their shared queue, which can be stolen from. Objects are claimed with GObject::tryMark(), so each one is only blackened once.
+    */
+    struct GMarkWorker {
+        std::vector<GObject*> stack; // only the owner touches this
+        std::mutex lock;
+        std::vector<GObject*> shared; // other workers steal from this
+        std::atomic<size_t> sharedSize{0};
+    };
+
+    struct GMarker {
+        std::mutex jobLock; // held by the isolate using the helpers
+        std::mutex lock;
+        std::condition_variable wake; // helpers wait on this for a job
+        std::condition_variable finished; // & the collecting thread waits on this for the helpers
+        std::vector<std::thread> threads;
+        std::vector<std::unique_ptr<GMarkWorker>> workers; // workers[0] is the collecting thread
+        GIsolate* job = NULL;
+        unsigned jobId = 0;
+        int running = 0; // helpers still working on the job
+        bool quit = false;
+
+        std::atomic<int> idle{0}; // workers that ran out of work
+        std::atomic<bool> timeUp{false};
+        std::chrono::steady_clock::time_point deadline;
+        bool hasDeadline = false;
+
+        ~GMarker() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                quit = true;
+            }
+            wake.notify_all();
+            for (std::thread& t : threads)
+                t.join();
+        }
+    };
+
+    static GMarker marker;
+    static thread_local GMarkWorker* markWorker = NULL; // set while this thread is marking in parallel
+    static int markThreads = GC_MARKTHREADS;
+#endif
+
+    struct GHeapWalker;
+    static thread_local GHeapWalker* heapWalker = NULL; // set while writeHeapSnapshot() is walking the heap
+
+    /* writeBarrier(parent, child)
+        Call this after storing child in parent (tables, upvalues, etc.) Minor collections don't trace old objects, so if an old object starts pointing to a 
+    young one, the young one has to be remembered or it would get freed out from under it! We remember the child instead of the parent so appending to a 
+    huge old table doesn't mean re-tracing the whole thing every minor collection.
+    */
+    inline void writeBarrier(GObject* parent, GValue child) {
+        if (!ISGVALUEOBJ(child))
+            return;
+
+        GObject* obj = READGVALUEOBJ(child);
+        if (parent->isOld && !obj->isOld && !obj->isRemembered)
+            rememberObject(obj);
+        else if (isolate->gcPhase == GC_MARK && parent->isMarked() && !obj->isMarked())
+            markObject(obj); // keeps the tri-color invariant
+    }
+
+    // for when you don't know what was stored, the whole parent is re-traced by the next minor collection (or slice)
+    inline void writeBarrier(GObject* parent) {
+        if (parent->isOld && !parent->isRemembered)
+            rememberObject(parent);
+        if (isolate->gcPhase == GC_MARK && parent->isMarked())
+            regrayObject(parent);
+    }
+
+    void markValue(GValue val);
+
+    template <typename T>
+    void markTable(GTable<T>* tbl);
+
+    template <typename T>
+    inline GValue newGValue(T x);
+
+    void blackenObject(GObject* obj);
+    void traceReferences();
+    void markStates();
     void markChunks();
 }
 
+#ifndef GAVEL_NO_POOL
+inline void* GObject::operator new(size_t sz) {
+    return Gavel::isolate->pool.alloc(sz);
+}
+#endif
+
 class GObjectTableBase : public GObject {
 public:
     GObjectTableBase() {}
@@ -790,32 +1697,121 @@ public:
     virtual int getLength() { return 0; }
 };
 
+/* GObjectString
+    Strings are immutable & variable sized, the characters (& a '\0', so str().data() works as a c string) live right after the object in the same 
+allocation. Make them with Gavel::addString(), or GObjectString::create() if you really need one outside the intern set. Natives can read the contents 
+with str() (or READGVALUESTRING()), which is a std::string_view into the object, so don't hold onto it longer than the string!
+
+    The hash is only computed when it's first needed (interning needs it right away though, so with GSTRING_INTERN addString() hands it over.)
+*/
 class GObjectString : public GObjectTableBase {
+private:
+    uint32_t length;
+    uint32_t hash = 0;
+    bool hashed = false;
+
+    GObjectString(const char* str, size_t len):
+        length(len) {
+        type = GOBJECT_STRING;
+        memcpy(getChars(), str, len);
+        getChars()[len] = '\0';
+    }
+
+    GObjectString(const char* str, size_t len, int h):
+        GObjectString(str, len) {
+        hash = h;
+        hashed = true;
+    }
+
+    inline char* getChars() { return reinterpret_cast<char*>(this + 1); }
+
+    // room for the characters after the object. only create() uses these
+    static void* operator new(size_t sz, size_t len) {
+#ifndef GAVEL_NO_POOL
+        return GObject::operator new(sz + len + 1);
+#else
+        return ::operator new(sz + len + 1);
+#endif
+    }
+
 public:
-    std::string val;
 #ifdef GSTRING_INTERN
     bool is_interned = false; // marked true if another value references this
 #endif
-    int hash;
 
-    GObjectString(std::string& b):
-        val(b) {
-        type = GOBJECT_STRING;
-        // make a hash specific for the type and the string
-        hash = std::hash<GObjType>()(GOBJECT_STRING) ^ std::hash<std::string>()(val);
+#ifndef GAVEL_NO_POOL
+    static void operator delete(void* ptr) { GPool::free(ptr); }
+#else
+    static void operator delete(void* ptr) { ::operator delete(ptr); }
+#endif
+
+    static GObjectString* create(std::string_view str) {
+        return new (str.size()) GObjectString(str.data(), str.size());
+    }
+
+    // h has to be hashString(str)
+    static GObjectString* create(std::string_view str, int h) {
+        return new (str.size()) GObjectString(str.data(), str.size(), h);
     }
 
     virtual ~GObjectString() {};
 
+    /* hashString(str)
+        64-bit multiply & xorshift mix (MurmurHash64A) over 8 bytes at a time, folded down to 32 bits. not cryptographic, tables mix it again anyways.
+    */
+    static inline int hashString(std::string_view str) {
+        const uint64_t m = 0xc6a4a7935bd1e995ULL;
+        const char* data = str.data();
+        size_t len = str.size();
+        uint64_t h = 0x9e3779b97f4a7c15ULL ^ (len * m);
+
+        while (len >= 8) {
+            uint64_t k;
+            memcpy(&k, data, 8);
+            k *= m;
+            k ^= k >> 47;
+            k *= m;
+            h ^= k;
+            h *= m;
+            data += 8;
+            len -= 8;
+        }
+
+        if (len > 0) {
+            uint64_t k = 0;
+            memcpy(&k, data, len);
+            h ^= k;
+            h *= m;
+        }
+
+        h ^= h >> 47;
+        h *= m;
+        h ^= h >> 47;
+        return (int)(uint32_t)(h ^ (h >> 32));
+    }
+
+    inline std::string_view str() const {
+        return std::string_view(reinterpret_cast<const char*>(this + 1), length);
+    }
+
     bool equals(GObject* other) {
+        // ropes compare their contents
+        if (other->type == GOBJECT_ROPE)
+            return other->equals(this);
+
+#ifdef GSTRING_INTERN
+        // every string is interned, so if it's not the same object it's not the same string
+        return other == this;
+#else
         if (other->type == type) {
-            return reinterpret_cast<GObjectString*>(other)->val.compare(val) == 0;
+            return reinterpret_cast<GObjectString*>(other)->str() == str();
         }
         return false;
+#endif
     }
 
     std::string toString() {
-        return val;
+        return std::string(str());
     }
 
     std::string toStringDataType() {
@@ -823,15 +1819,24 @@ public:
     }
 
     GObject* clone() {
-        return new GObjectString(val);
+        return create(str());
     }
 
     int getHash() {
+        if (!hashed) {
+            hash = hashString(str());
+            hashed = true;
+        }
         return hash;
     }
 
+    // the characters live in the same allocation, so count what the pool really handed out (slot rounding or the big object header)
     size_t getSize() { 
-        return sizeof(GObjectString); 
+#ifndef GAVEL_NO_POOL
+        return GPool::allocSize(sizeof(GObjectString) + length + 1);
+#else
+        return sizeof(GObjectString) + length + 1; 
+#endif
     };
 
     // Table stuff
@@ -844,35 +1849,135 @@ public:
 
         int intIndex = (int)READGVALUENUMBER(key);
 
-        if (intIndex >= val.length() || intIndex < 0) {
+        if (intIndex >= (int)length || intIndex < 0) {
             return CREATECONST_NIL();
         }
 
-        return CREATECONST_CHARACTER(val[intIndex]);
+        return CREATECONST_CHARACTER(str()[intIndex]);
     }
 
-    void setIndex(GValue key, GValue v) {
-        // they can only index using integers and set using characters
-        if (!ISGVALUENUMBER(key) || !ISGVALUECHARACTER(v))
-            return;
+    // strings are immutable (they're interned & the hash is cached), so this does nothing. same as OP_NEWINDEX on a string
+    void setIndex(GValue key, GValue v) {}
+
+    // gives the number of key/value pairs are in the table
+    int getLength() {
+        return length;
+    }
+};
+
+/* GObjectRope
+    What OP_CONCAT makes when the result is long (GSTRING_ROPEMIN), or when it's appending to another rope. Ropes share a buffer: appending to the rope that 
+wrote the end of the buffer just appends to it in place & makes a new rope with a longer length, the old one still only sees it's own prefix. So 's = s .. x' 
+in a loop is amortized O(1) instead of copying s every time. Appending to any other rope copies it into a new buffer.
+
+    The buffer is counted by the GC once, no matter how many ropes share it: it keeps track of how much of it's capacity is in Gavel::bytesAllocated 
+(see Gavel::resizeBuffer) & the last rope using it takes that back out. Ropes only count themselves.
+
+    Ropes are flattened into a real (interned) GObjectString with flatten() when they're used as a table key, passed to a c function or iterated over, so 
+natives only ever see ropes if they dig them out of a table or a global. Use Gavel::flattenValue() (or toString()) there. Scripts can't tell the difference,
+ropes index, compare & print like strings.
+*/
+class GObjectRope : public GObjectTableBase {
+public:
+    struct GRopeBuffer : public std::string {
+        size_t counted = 0; // bytes of this buffer in Gavel::bytesAllocated
+    };
+
+    std::shared_ptr<GRopeBuffer> buf;
+    size_t len;
+    GObjectString* flat = NULL; // cached by flatten()
+
+    GObjectRope(std::shared_ptr<GRopeBuffer> b, size_t l): buf(b), len(l) {
+        type = GOBJECT_ROPE;
+    }
+
+    // ropes are only ever freed on the isolate's own thread (the background sweeper defers them), so this is safe
+    virtual ~GObjectRope() {
+        if (buf.use_count() == 1)
+            Gavel::resizeBuffer(buf->counted, 0);
+    }
+
+    // true if nothing was appended to buf after us, so we can append in place
+    inline bool isTip() {
+        return buf->size() == len;
+    }
+
+    GObjectString* flatten();
+
+    bool equals(GObject* other) {
+        if (other == this)
+            return true;
+
+        if (other->type == GOBJECT_STRING) {
+            std::string_view str = reinterpret_cast<GObjectString*>(other)->str();
+            return str.length() == len && str.compare(0, len, std::string_view(*buf).substr(0, len)) == 0;
+        }
+
+        if (other->type == GOBJECT_ROPE) {
+            GObjectRope* rope = reinterpret_cast<GObjectRope*>(other);
+            return rope->len == len && rope->buf->compare(0, len, *buf, 0, len) == 0;
+        }
+        return false;
+    }
+
+    std::string toString() {
+        return buf->substr(0, len);
+    }
+
+    std::string toStringDataType() {
+        return "[STRING]";
+    }
+
+    GObject* clone() {
+        return new GObjectRope(buf, len);
+    }
+
+    int getHash() {
+        return GObjectString::hashString(toString());
+    }
+
+    size_t getSize() {
+        return sizeof(GObjectRope);
+    }
+
+    GValue getIndex(GValue key) {
+        if (!ISGVALUENUMBER(key))
+            return CREATECONST_NIL();
 
         int intIndex = (int)READGVALUENUMBER(key);
-        if (intIndex >= val.length() || intIndex < 0)
-            return;
+        if (intIndex >= (int)len || intIndex < 0)
+            return CREATECONST_NIL();
 
-        val[intIndex] = READGVALUECHARACTER(v);
+        return CREATECONST_CHARACTER((*buf)[intIndex]);
     }
 
-    // gives the number of key/value pairs are in the table
     int getLength() {
-        return val.size();
+        return len;
     }
 };
 
+inline GObjectString* GObjectRope::flatten() {
+    if (flat == NULL) {
+        flat = Gavel::addString(toString());
+        Gavel::writeBarrier(this, GValue((GObject*)flat));
+    }
+    return flat;
+}
+
+namespace Gavel {
+    // gives the string a rope is holding, anything else is returned as is
+    inline GValue flattenValue(GValue v) {
+        if (ISGVALUEROPE(v))
+            return GValue((GObject*)reinterpret_cast<GObjectRope*>(READGVALUEOBJ(v))->flatten());
+        return v;
+    }
+}
+
 // Similar to closures, however this binds a c function to a prototable
 class GObjectBoundCall : public GObject {
 public:
-    GAVELCFUNC var;
+    GAVELCFUNC var = NULL;
+    GAVELSPANFUNC spanVar = NULL; // only one of these is ever set
     GObjectTableBase* tbl;
     bool alive; // this will keep track if the bound table is still alive.
 
@@ -881,11 +1986,49 @@ public:
         type = GOBJECT_BOUNDCALL;
         alive = true;
     }
+
+    GObjectBoundCall(GAVELSPANFUNC cfunc, GObjectTableBase* tblObj): 
+        spanVar(cfunc), tbl(tblObj) {
+        type = GOBJECT_BOUNDCALL;
+        alive = true;
+    }
+
+    size_t getSize() {
+        return sizeof(GObjectBoundCall);
+    }
 };
 
+/* GObjectTable
+        Tables have 2 parts, a dense array part (arr) holding the keys 0 to arr.size()-1, and a hash part (val) for everything else. Appending the next index to the array part
+    also pulls any following indexes out of the hash part, so arrays filled out of order still end up in the array part. 
+*/
 class GObjectTable : public GObjectTableBase {
+private:
+    // returns true if key is a number that could be an index in the array part
+    static inline bool getArrayIndex(GValue key, uint32_t& i) {
+        if (!ISGVALUENUMBER(key))
+            return false;
+
+        double n = READGVALUENUMBER(key);
+        if (!(n >= 0 && n < (double)UINT32_MAX)) // also catches NaN
+            return false;
+
+        i = (uint32_t)n;
+        return (double)i == n;
+    }
+
+    // moves the indexes that come right after the array part from the hash part to the array part
+    void migrateToArray() {
+        GValue v;
+        while (val.getSize() > 0 && val.checkGetIndex(CREATECONST_NUMBER(arr.size()), v)) {
+            val.deleteKey(CREATECONST_NUMBER(arr.size()));
+            arr.push_back(v);
+        }
+    }
+
 public:
-    GTable<GValue> val;
+    std::vector<GValue> arr; // array part
+    GTable<GValue> val; // hash part
     int hash;
 
     GObjectTable(GTable<GValue> v = GTable<GValue>()): val(v) {
@@ -919,16 +2062,70 @@ public:
     }
 
     size_t getSize() { 
-        return sizeof(GObjectTable); 
+        return sizeof(GObjectTable) + arr.capacity() * sizeof(GValue) + val.getMemory(); 
     };
 
+    // lets the GC know if the array or hash part grew
+    inline void updateSize() {
+        if (gcSize != 0 && gcSize != GObjectTable::getSize())
+            Gavel::resizeObject(this, GObjectTable::getSize());
+    }
+
     // Methods specifically for GObjectTable
     GValue getIndex(GValue key) {
+        uint32_t i;
+        if (getArrayIndex(key, i) && i < arr.size())
+            return arr[i];
+
         return val.getIndex(key);
     }
 
     void setIndex(GValue key, GValue v) {
+        Gavel::writeBarrier(this, key);
+        Gavel::writeBarrier(this, v);
+
+        uint32_t i;
+        if (getArrayIndex(key, i)) {
+            if (i < arr.size()) {
+                arr[i] = v;
+                return;
+            }
+
+            // appending to the array part
+            if (i == arr.size()) {
+                arr.push_back(v);
+                migrateToArray();
+                updateSize();
+                return;
+            }
+        }
+
         val.setIndex(key, v);
+        updateSize();
+    }
+
+    /* next(i, key, value)
+        Walks the array part, then the hash part. Start with i at 0, returns false when there's nothing left. This is safe to call while the table is being modified
+    (although you might skip or repeat entries).
+    */
+    bool next(uint32_t& i, GValue& key, GValue& value) {
+        if (i < arr.size()) {
+            key = CREATECONST_NUMBER(i);
+            value = arr[i++];
+            return true;
+        }
+
+        for (uint32_t h = i - arr.size(); h < val.getCapacity(); h++) {
+            GTable<GValue>::Node& node = val.getNode(h);
+            if (node.dist != 0) {
+                key = node.key;
+                value = node.val;
+                i = arr.size() + h + 1;
+                return true;
+            }
+        }
+
+        return false;
     }
 
     // template versions
@@ -943,7 +2140,7 @@ public:
     }
 
     int getLength() {
-        return val.getSize();
+        return arr.size() + val.getSize();
     }
 };
 
@@ -1030,6 +2227,11 @@ private:
             Gavel::addGarbage((GObject*)val);
         }
 
+        GProtoCFunction(GAVELSPANFUNC v, GObjectTableBase* bse) {
+            val = new GObjectBoundCall(v, bse);
+            Gavel::addGarbage((GObject*)val);
+        }
+
         ~GProtoCFunction() {
             val->alive = false;
         }
@@ -1065,7 +2267,7 @@ private:
         } else if constexpr (std::is_same<T, std::string*>()) {
             result = new GProtoString(v);
         // GProtoCFunction
-        } else if constexpr (std::is_same<T, GAVELCFUNC>()) {
+        } else if constexpr (std::is_same<T, GAVELCFUNC>() || std::is_same<T, GAVELSPANFUNC>()) {
             result = new GProtoCFunction(v, this);
         }
 
@@ -1130,7 +2332,8 @@ public:
     }
 
     size_t getSize() { 
-        return sizeof(GObjectPrototable); 
+        // each entry is a node in the unordered_map & a GProto (which are all about the same size)
+        return sizeof(GObjectPrototable) + hashTable.bucket_count() * sizeof(void*) + hashTable.size() * (sizeof(void*) * 2 + sizeof(Entry) + sizeof(GProtoCFunction));
     };
     
     template<typename T, typename T2>
@@ -1139,6 +2342,7 @@ public:
 
         if (value != NULL) { // a valid GProto
             hashTable[Gavel::newGValue(key)] = value;
+            Gavel::writeBarrier(this); // the key & GProtoCFunction's bound call are new objects
         }
     }
 
@@ -1169,6 +2373,14 @@ struct GChunk {
     std::vector<GObjectString*> identifiers;
     std::vector<int> lineInfo;
 
+    // caches which global slot each identifier resolved to, so OP_*GLOBAL only needs to hash the identifier once. (see GState::getGlobal)
+    //  * a chunk can be ran by more than one state, so we remember which state the slot belongs to
+    struct GGlobalCache {
+        uint32_t stateId = 0;
+        int slot = -1;
+    };
+    std::vector<GGlobalCache> globalCache; // same size as identifiers
+
     // default constructor
     GChunk() {}
 
@@ -1184,6 +2396,12 @@ struct GChunk {
         DEBUGGC(std::cout << "-- DONE FREEING CHUNK " << this << std::endl);
     }
 
+    // bytes owned by the chunk itself. (the constants it owns are counted by GPool, strings by the GC)
+    size_t getSize() {
+        return sizeof(GChunk) + code.capacity() * sizeof(INSTRUCTION) + constants.capacity() * sizeof(GValue) + identifiers.capacity() * sizeof(GObjectString*) 
+            + lineInfo.capacity() * sizeof(int) + globalCache.capacity() * sizeof(GGlobalCache);
+    }
+
     int addInstruction(INSTRUCTION i, int line) {
         // add INSTRUCTION to our instruction table
         code.push_back(i);
@@ -1195,9 +2413,10 @@ struct GChunk {
         code[i] = inst;
     }
 
-    // erases the instruction from the code vector
+    // erases the instruction (and it's line info) from the code vector
     void removeInstruction(int i) {
         code.erase(code.begin() + i);
+        lineInfo.erase(lineInfo.begin() + i);
     }
 
     int addIdentifier(std::string id) {
@@ -1206,12 +2425,13 @@ struct GChunk {
             return tmpId;
 
         identifiers.push_back(Gavel::addString(id));
+        globalCache.push_back(GGlobalCache());
         return identifiers.size() - 1;
     }
 
     int findIdentifier(std::string id) {
         for (int i = 0; i < identifiers.size(); i++) {
-            if (identifiers[i]->val.compare(id) == 0)
+            if (identifiers[i]->str() == id)
                 return i;
         }
 
@@ -1297,6 +2517,12 @@ struct GChunk {
                 return "OP_GREATER";
             case OP_LESS: 
                 return  "OP_LESS";
+            case OP_EQUALRK: 
+                return "OP_EQUALRK";
+            case OP_GREATERRK:
+                return "OP_GREATERRK";
+            case OP_LESSRK: 
+                return  "OP_LESSRK";
             case OP_NEGATE: 
                 return "OP_NEGATE";
             case OP_NOT: 
@@ -1313,12 +2539,34 @@ struct GChunk {
                 return "OP_DIV";
             case OP_MOD: 
                 return "OP_MOD";
+            case OP_ADDRK: 
+                return "OP_ADDRK";
+            case OP_SUBRK: 
+                return "OP_SUBRK";
+            case OP_MULRK: 
+                return "OP_MULRK";
+            case OP_DIVRK: 
+                return "OP_DIVRK";
+            case OP_MODRK: 
+                return "OP_MODRK";
             case OP_INC: 
                 return "OP_INC";
             case OP_DEC: 
                 return "OP_DEC";
             case OP_CONCAT:
                 return "OP_CONCAT";
+            case OP_GETBASE2:
+                return "OP_GETBASE2";
+            case OP_ADDK:
+                return "OP_ADDK";
+            case OP_INCLOCAL:
+                return "OP_INCLOCAL";
+            case OP_EQJMP:
+                return "OP_EQJMP";
+            case OP_LTJMP:
+                return "OP_LTJMP";
+            case OP_GTJMP:
+                return "OP_GTJMP";
             case OP_TRUE: 
                 return "OP_TRUE";
             case OP_FALSE: 
@@ -1336,10 +2584,18 @@ struct GChunk {
         }
     }
 
+    // for the disassembler
+    std::string getRKName(int rk) {
+        if (ISK(rk))
+            return constants[INDEXK(rk)].toString();
+        return "local[" + std::to_string(rk) + "]";
+    }
+
     void disassemble(int level = 0);
+    void optimize();
 };
 
-class GObjectFunction : GObject {
+class GObjectFunction : public GObject {
 private:
     int expectedArgs;
     int upvalues = 0;
@@ -1379,6 +2635,11 @@ public:
         return hash;
     }
 
+    // the chunk isn't counted, it's freed with the function & doesn't change while scripts run (see Gavel::getHeapStats)
+    size_t getSize() {
+        return sizeof(GObjectFunction) + getStringHeapSize(name);
+    }
+
     int getArgs() {
         return expectedArgs;
     }
@@ -1430,9 +2691,13 @@ void GChunk::disassemble(int level) {
                 std::cout << "Ax: " + std::to_string(GETARG_Ax(i)) << "| ";
                 break;
             }
+            case OPTYPE_IABC: {
+                std::cout << "A: " + std::to_string(GETARG_A(i)) << " B: " + std::to_string(GETARG_B(i)) << " C: " + std::to_string(GETARG_C(i)) << "| ";
+                break;
+            }
             case OPTYPE_CLOSURE: {
                 int indx = GETARG_Ax(i);
-                GObjectFunction* func = (GObjectFunction*)(constants[indx]).val.obj;
+                GObjectFunction* func = (GObjectFunction*)READGVALUEOBJ(constants[indx]);
 
                 std::cout << func->toString();
                 // the upval types are encoded in the instruction chunk (i just reuse OP_GETBASE & OP_GETUPVAL because it's readable and they arleady exist)
@@ -1482,6 +2747,38 @@ void GChunk::disassemble(int level) {
                 std::cout << constants[indx].toStringDataType() << ": " << constants[indx].toString();
                 break;
             }
+            // register-based instructions
+            case OP_EQUALRK:
+            case OP_GREATERRK:
+            case OP_LESSRK:
+            case OP_ADDRK:
+            case OP_SUBRK:
+            case OP_MULRK:
+            case OP_DIVRK:
+            case OP_MODRK: {
+                std::cout << (GETARG_A(i) == 0 ? std::string("push") : "local[" + std::to_string(GETARG_A(i)) + "]") << " = " << getRKName(GETARG_B(i)) << ", " << getRKName(GETARG_C(i));
+                break;
+            }
+            // superinstructions
+            case OP_GETBASE2: {
+                std::cout << "push local[" << GETARG_A(i) << "], local[" << GETARG_B(i) << "]";
+                break;
+            }
+            case OP_ADDK: {
+                std::cout << "+ " << constants[GETARG_Ax(i)].toString();
+                break;
+            }
+            case OP_INCLOCAL: {
+                std::cout << "local[" << GETARG_A(i) << "]" << (GETARG_B(i) == 0 ? "++" : "--");
+                break;
+            }
+            case OP_EQJMP:
+            case OP_LTJMP:
+            case OP_GTJMP: {
+                const char* cmp = (op == OP_EQJMP ? " == " : (op == OP_LTJMP ? " < " : " > "));
+                std::cout << "if (" << getRKName(GETARG_B(i)) << cmp << getRKName(GETARG_C(i)) << ") == " << (GETARG_A(i) ? "true" : "false") << " jump";
+                break;
+            }
             // loads from identifiers
             case OP_DEFINEGLOBAL:
             case OP_GETGLOBAL:
@@ -1497,9 +2794,155 @@ void GChunk::disassemble(int level) {
 }
 
 #undef DISASSM_LEVEL
+
+/* GChunk::optimize()
+    Peephole pass over the chunk (and every function in it's constants), GavelParser::compile() runs this unless GAVEL_NO_PEEPHOLE is defined. 
+Fuses these sequences the parser emits into superinstructions:
+        GETBASE x, INC/DEC, SETBASE x, POP 1 [, POP 1]      -> INCLOCAL x
+        EQUALRK/LESSRK/GREATERRK 0 B C, [NOT,] IFJMP        -> EQJMP/LTJMP/GTJMP B C, JMP
+        LOADCONST k, ADD                                    -> ADDK k
+        GETBASE a, GETBASE b                                -> GETBASE2 a b
+        POP a, POP b                                        -> POP a+b
+    A sequence is left alone if anything jumps into the middle of it. Jump offsets and lineInfo are fixed up afterwards.
+*/
+void GChunk::optimize() {
+    int size = code.size();
+
+    // find every instruction something jumps to, and the upvalue descriptions after OP_CLOSURE (those aren't real instructions, so don't touch them!)
+    std::vector<bool> isTarget(size + 1, false);
+    std::vector<bool> isData(size, false);
+    for (int i = 0; i < size; i++) {
+        INSTRUCTION inst = code[i];
+        switch (GET_OPCODE(inst)) {
+            case OP_IFJMP:
+            case OP_CNDNOTJMP:
+            case OP_CNDJMP:
+            case OP_JMP:
+                isTarget[i + 1 + GETARG_Ax(inst)] = true;
+                break;
+            case OP_JMPBACK:
+                isTarget[i + 1 - GETARG_Ax(inst)] = true;
+                break;
+            case OP_CLOSURE: {
+                GObjectFunction* func = (GObjectFunction*)READGVALUEOBJ(constants[GETARG_Ax(inst)]);
+                for (int x = 0; x < func->getUpvalueCount(); x++)
+                    isData[++i] = true;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // returns -1 past the end of the chunk so patterns can look ahead without checking the size
+    auto opAt = [&](int i) {
+        return i < size && !isData[i] ? (int)GET_OPCODE(code[i]) : -1;
+    };
+
+    // true if the instructions after start (up to start+len) aren't jumped to, so the sequence can be fused into one
+    auto canFuse = [&](int start, int len) {
+        for (int x = start + 1; x < start + len; x++) {
+            if (isTarget[x])
+                return false;
+        }
+        return true;
+    };
+
+    std::vector<INSTRUCTION> newCode;
+    std::vector<int> newLines;
+    std::vector<int> newIndex(size + 1); // where every old instruction ended up
+    std::vector<std::pair<int, int>> jumps; // (index of the jump in newCode, old index of it's target)
+
+    int i = 0;
+    while (i < size) {
+        INSTRUCTION inst = code[i];
+        int op = opAt(i);
+        int len = 1; // how many old instructions we used
+        int start = newCode.size();
+        int line = lineInfo[i]; // fused instructions use the line of the instruction that can throw an objection
+
+        if (op == OP_GETBASE && GETARG_Ax(inst) <= MASK(SIZE_A) && (opAt(i+1) == OP_INC || opAt(i+1) == OP_DEC) && opAt(i+2) == OP_SETBASE 
+            && GETARG_Ax(code[i+2]) == GETARG_Ax(inst) && opAt(i+3) == OP_POP && GETARG_Ax(code[i+3]) == 1 && canFuse(i, 4)) {
+            // x++; as a statement leaves nothing on the stack, otherwise leave what OP_INC would've left
+            bool discarded = opAt(i+4) == OP_POP && GETARG_Ax(code[i+4]) == 1 && canFuse(i, 5);
+            int pushed = discarded ? 0 : GETARG_Ax(code[i+1]);
+            newCode.push_back(CREATE_iABC(OP_INCLOCAL, GETARG_Ax(inst), opAt(i+1) == OP_DEC ? 1 : 0, pushed));
+            line = lineInfo[i+1];
+            len = discarded ? 5 : 4;
+        } else if ((op == OP_EQUALRK || op == OP_LESSRK || op == OP_GREATERRK) && GETARG_A(inst) == 0 
+            && (opAt(i+1) == OP_IFJMP || (opAt(i+1) == OP_NOT && opAt(i+2) == OP_IFJMP))) {
+            bool negated = opAt(i+1) == OP_NOT;
+            int jmp = i + 1 + negated;
+            if (canFuse(i, jmp - i + 1)) {
+                // OP_IFJMP jumps if the result is false, so we jump if (B op C) == negated
+                int fused = op == OP_EQUALRK ? OP_EQJMP : (op == OP_LESSRK ? OP_LTJMP : OP_GTJMP);
+                newCode.push_back(CREATE_iABC(fused, negated, GETARG_B(inst), GETARG_C(inst)));
+                jumps.push_back({newCode.size(), jmp + 1 + GETARG_Ax(code[jmp])});
+                newCode.push_back(CREATE_iAx(OP_JMP, 0)); // offset is fixed up below
+                newLines.push_back(line);
+                len = jmp - i + 1;
+            }
+        } else if (op == OP_LOADCONST && opAt(i+1) == OP_ADD && canFuse(i, 2)) {
+            newCode.push_back(CREATE_iAx(OP_ADDK, GETARG_Ax(inst)));
+            line = lineInfo[i+1];
+            len = 2;
+        } else if (op == OP_GETBASE && opAt(i+1) == OP_GETBASE && opAt(i+2) != OP_INC && opAt(i+2) != OP_DEC && canFuse(i, 2)
+            && GETARG_Ax(inst) <= MASK(SIZE_A) && GETARG_Ax(code[i+1]) <= MASK(SIZE_B)) {
+            newCode.push_back(CREATE_iABC(OP_GETBASE2, GETARG_Ax(inst), GETARG_Ax(code[i+1]), 0));
+            len = 2;
+        } else if (op == OP_POP) {
+            int pops = GETARG_Ax(inst);
+            while (opAt(i + len) == OP_POP && canFuse(i, len + 1))
+                pops += GETARG_Ax(code[i + len++]);
+            newCode.push_back(CREATE_iAx(OP_POP, pops));
+        }
+
+        if (newCode.size() == start) { // nothing was fused, copy it as-is
+            newCode.push_back(inst);
+            switch (op) {
+                case OP_IFJMP:
+                case OP_CNDNOTJMP:
+                case OP_CNDJMP:
+                case OP_JMP:
+                    jumps.push_back({start, i + 1 + GETARG_Ax(inst)});
+                    break;
+                case OP_JMPBACK:
+                    jumps.push_back({start, i + 1 - GETARG_Ax(inst)});
+                    break;
+                default:
+                    break;
+            }
+        }
+        newLines.push_back(line);
+
+        for (int x = i; x < i + len; x++)
+            newIndex[x] = start;
+        i += len;
+    }
+    newIndex[size] = newCode.size();
+
+    // fix up the jump offsets
+    for (std::pair<int, int>& jmp : jumps) {
+        INSTRUCTION inst = newCode[jmp.first];
+        int target = newIndex[jmp.second];
+        if (GET_OPCODE(inst) == OP_JMPBACK)
+            newCode[jmp.first] = CREATE_iAx(OP_JMPBACK, jmp.first + 1 - target);
+        else
+            newCode[jmp.first] = CREATE_iAx(GET_OPCODE(inst), target - (jmp.first + 1));
+    }
+
+    code = newCode;
+    lineInfo = newLines;
+
+    // optimize the functions declared in this chunk too
+    for (GValue c : constants) {
+        if (ISGVALUEFUNCTION(c))
+            READGVALUEFUNCTION(c)->optimize();
+    }
+}
 #endif
 
-class GObjectClosure : GObject {
+class GObjectClosure : public GObject {
 private:
     int hash;
 public:
@@ -1539,12 +2982,181 @@ public:
         // make a hash specific for the type and the GObjectFunction
         return hash;
     }
+
+    size_t getSize() {
+        return sizeof(GObjectClosure) + upvalueCount * sizeof(GObjectUpvalue*);
+    }
 };
 
-struct GCallFrame {
-    GObjectClosure* closure; // current function we're in
-    INSTRUCTION* pc; // current pc
-    GValue* basePointer; // our base in the stack to offset for locals and temps
+/* GOutputSink
+    Where a GState's output ends up (see GOutput::setSink()), subclass it to send it somewhere else. write() gets whole buffers at a time, flush() is called
+when the host should see everything written so far.
+*/
+class GOutputSink {
+public:
+    virtual ~GOutputSink() {}
+    virtual void write(const char* data, size_t len) = 0;
+    virtual void flush() {}
+};
+
+// writes to a FILE*, this is what every GState starts with (stdout). going through stdio keeps it in order with anything else the host prints
+class GFileSink : public GOutputSink {
+public:
+    FILE* file;
+
+    GFileSink(FILE* f): file(f) {}
+
+    void write(const char* data, size_t len) {
+        fwrite(data, 1, len, file);
+    }
+
+    void flush() {
+        fflush(file);
+    }
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+// writes straight to a file descriptor, one write() per buffer
+class GFdSink : public GOutputSink {
+public:
+    int fd;
+
+    GFdSink(int f): fd(f) {}
+
+    void write(const char* data, size_t len) {
+        while (len > 0) {
+            ssize_t wrote = ::write(fd, data, len);
+            if (wrote <= 0)
+                return; // nowhere to report it, just drop it
+            data += wrote;
+            len -= wrote;
+        }
+    }
+};
+#endif
+
+// keeps everything in memory, handy for capturing what a script printed
+class GStringSink : public GOutputSink {
+public:
+    std::string out;
+
+    void write(const char* data, size_t len) {
+        out.append(data, len);
+    }
+};
+
+// hands every buffer to a c callback
+typedef void (*GAVELOUTPUTFUNC)(const char* data, size_t len, void* userData);
+
+class GCallbackSink : public GOutputSink {
+public:
+    GAVELOUTPUTFUNC func;
+    void* userData;
+
+    GCallbackSink(GAVELOUTPUTFUNC f, void* ud = NULL): func(f), userData(ud) {}
+
+    void write(const char* data, size_t len) {
+        func(data, len, userData);
+    }
+};
+
+/* GOutput
+    Buffers a GState's output (GState::output), print & input write to this instead of stdout. The buffer is handed to the sink when it's full, when 
+flush() is called, when GState::start() or resume() return, & when print (or the VM, see tick()) notices it's been GOUTPUT_FLUSHINTERVAL ms since the last 
+flush. Sinks aren't owned by the GOutput, they need to outlive the state (or be swapped out with setSink() first).
+*/
+class GOutput {
+private:
+    GFileSink stdoutSink{stdout};
+    GOutputSink* sink = &stdoutSink;
+    std::unique_ptr<char[]> buffer{new char[GOUTPUT_BUFFERSIZE]};
+    size_t used = 0;
+    int ticks = GOUTPUT_TICKS;
+    std::chrono::milliseconds flushInterval{GOUTPUT_FLUSHINTERVAL};
+    std::chrono::steady_clock::time_point lastFlush = std::chrono::steady_clock::now();
+
+    void writeBuffer() {
+        if (used > 0) {
+            sink->write(buffer.get(), used);
+            used = 0;
+        }
+    }
+
+public:
+    GOutput() {}
+    GOutput(const GOutput&) = delete;
+
+    ~GOutput() {
+        flush();
+    }
+
+    // NULL goes back to stdout. anything already buffered goes to the old sink first
+    void setSink(GOutputSink* s) {
+        flush();
+        sink = s != NULL ? s : &stdoutSink;
+    }
+
+    GOutputSink* getSink() {
+        return sink;
+    }
+
+    void setFlushInterval(int ms) {
+        flushInterval = std::chrono::milliseconds(ms);
+    }
+
+    inline void write(const char* data, size_t len) {
+        if (used + len > GOUTPUT_BUFFERSIZE) {
+            writeBuffer();
+
+            // too big to be worth buffering
+            if (len > GOUTPUT_BUFFERSIZE) {
+                sink->write(data, len);
+                return;
+            }
+        }
+
+        memcpy(buffer.get() + used, data, len);
+        used += len;
+    }
+
+    inline void write(std::string_view str) {
+        write(str.data(), str.size());
+    }
+
+    inline void write(char c) {
+        if (used == GOUTPUT_BUFFERSIZE)
+            writeBuffer();
+        buffer[used++] = c;
+    }
+
+    /* tick()
+        The VM calls this on loop back-edges & at it's GC checks, so output doesn't sit in the buffer while a script computes for a long time after 
+    printing. It's a load & a branch when nothing is buffered.
+    */
+    inline void tick() {
+        if (used > 0 && --ticks == 0) {
+            ticks = GOUTPUT_TICKS;
+            checkFlush();
+        }
+    }
+
+    // flushes if anything's been sitting in the buffer for longer than the flush interval
+    inline void checkFlush() {
+        if (used > 0 && flushInterval.count() > 0 && std::chrono::steady_clock::now() - lastFlush >= flushInterval)
+            flush();
+    }
+
+    void flush() {
+        writeBuffer();
+        sink->flush();
+        lastFlush = std::chrono::steady_clock::now();
+    }
+};
+
+struct GCallFrame {
+    GObjectClosure* closure; // current function we're in
+    INSTRUCTION* pc; // current pc
+    GValue* basePointer; // our base in the stack to offset for locals and temps
 };
 
 /* GStack
@@ -1619,7 +3231,7 @@ public:
         This pushes a frame to our callstack, with the given function, and offset in stack for the basePointer
     */
     inline bool pushFrame(GObjectClosure* closure, int a) {
-        if (getCallCount() >= CALLS_MAX) {
+        if (getCallCount() >= CALLS_MAX || top + MAX_LOCALS >= container + STACK_MAX) {
             return false;
         }
 
@@ -1666,14 +3278,96 @@ typedef enum {
     GSTATE_COMPILER_OBJECTION
 } GStateStatus;
 
+#ifdef GAVEL_COUNTINSTRUCTIONS
+#define COUNT_INSTRUCTION() instructionCount++
+#else
+#define COUNT_INSTRUCTION()
+#endif
+
+#ifdef GAVEL_COMPUTEDGOTO
+// every instruction gets it's own label, so DISPATCH() can jump straight to the next instruction's handler
+#define VMCASE(op) case op: LABEL_##op
+#define DISPATCH() { \
+    inst = *(frame->pc)++; \
+    COUNT_INSTRUCTION(); \
+    DEBUGLOG(std::cout << "OP: " << GChunk::getOpCodeName(GET_OPCODE(inst)) << std::endl); \
+    goto *dispatchTable[GET_OPCODE(inst)]; \
+}
+#else
+#define VMCASE(op) case op
+#define DISPATCH() break
+#endif
+
+// runs the GC if it's due, & throws an objection if the script went over the isolate's memory limit
+#define CHECK_GARBAGE() { \
+    output.tick(); \
+    if (!Gavel::checkGarbage()) { \
+        throwObjection("memory limit exceeded"); \
+        break; \
+    } \
+}
+
 #define BINARY_OP(op) { \
     GValue num1 = stack.pop(); \
     GValue num2 = stack.pop(); \
-    if (num1.type != GAVEL_TNUMBER || num2.type != GAVEL_TNUMBER) { \
+    if (!ISGVALUENUMBER(num1) || !ISGVALUENUMBER(num2)) { \
         throwObjection("Cannot perform arithmetic on " + num1.toStringDataType() + " and " + num2.toStringDataType()); \
         break; \
     } \
-    stack.push(GValue(num2.val.number op num1.val.number)); \
+    stack.push(GValue(READGVALUENUMBER(num2) op READGVALUENUMBER(num1))); \
+}
+
+// returns from the current frame, leaving the return value on the stack. if it's the frame run() was entered with, hand the status back to whoever called run()
+#define RETURN_FRAME(stat) { \
+    if (frame == entryFrame) \
+        return stat; \
+    GValue retResult = stack.pop(); \
+    closeUpvalues(frame->basePointer); \
+    stack.popFrame(); \
+    stack.push(retResult); \
+    frame = stack.getFrame(); \
+    currentChunk = frame->closure->val->val; \
+    DISPATCH(); \
+}
+
+// reads an RK operand, either a constant or a local from the current frame
+#define READRK(x) (ISK(x) ? currentChunk->constants[INDEXK(x)] : frame->basePointer[x])
+
+// moves the result of a register-based instruction to R[A], if A is 0 it's pushed onto the stack instead
+#define SETRA(v) { \
+    int a = GETARG_A(inst); \
+    if (a == 0) \
+        stack.push(v); \
+    else \
+        frame->basePointer[a] = v; \
+}
+
+#define RK_BINARY_OP(op) { \
+    GValue num1 = READRK(GETARG_B(inst)); \
+    GValue num2 = READRK(GETARG_C(inst)); \
+    if (!ISGVALUENUMBER(num1) || !ISGVALUENUMBER(num2)) { \
+        throwObjection("Cannot perform arithmetic on " + num2.toStringDataType() + " and " + num1.toStringDataType()); \
+        break; \
+    } \
+    SETRA(GValue(READGVALUENUMBER(num1) op READGVALUENUMBER(num2))); \
+}
+
+// the OP_JMP after a compare & jump superinstruction is taken right here, so it's never dispatched
+#define COMPARE_JMP(res) { \
+    if ((res) == (bool)GETARG_A(inst)) \
+        frame->pc += GETARG_Ax(*frame->pc) + 1; \
+    else \
+        frame->pc++; \
+}
+
+#define RK_COMPARE_JMP(op) { \
+    GValue num1 = READRK(GETARG_B(inst)); \
+    GValue num2 = READRK(GETARG_C(inst)); \
+    if (!ISGVALUENUMBER(num1) || !ISGVALUENUMBER(num2)) { \
+        throwObjection("Cannot perform arithmetic on " + num2.toStringDataType() + " and " + num1.toStringDataType()); \
+        break; \
+    } \
+    COMPARE_JMP(READGVALUENUMBER(num1) op READGVALUENUMBER(num2)); \
 }
 
 /* GState 
@@ -1681,10 +3375,45 @@ typedef enum {
 */
 class GState {
 private:
-    GTable<GObjectString*> globals;
+    struct GGlobal {
+        GObjectString* id;
+        GValue val;
+        bool defined; // OP_SETGLOBAL can only set globals that were defined
+    };
+
+    // globals live in a flat array, globalSlots maps the identifier to it's index. slots are never removed, so a resolved index stays valid
+    GTable<GObjectString*> globalSlots;
+    std::vector<GGlobal> globals;
+    uint32_t stateId; // so GChunk::globalCache knows which state it's slots belong to
     GObjectUpvalue* openUpvalueList = NULL; // tracks our closed upvalues
     GStateStatus status = GSTATE_OK;
 
+    static uint32_t newStateId() {
+        static std::atomic<uint32_t> lastId(0);
+        return ++lastId;
+    }
+
+    // returns the slot for the identifier, making a new (undefined) one if it doesn't exist yet
+    int getGlobalSlot(GObjectString* id) {
+        GValue slot;
+        if (globalSlots.checkGetIndex(id, slot))
+            return (int)READGVALUENUMBER(slot);
+
+        globals.push_back({id, CREATECONST_NIL(), false});
+        globalSlots.setIndex(id, CREATECONST_NUMBER(globals.size() - 1));
+        return globals.size() - 1;
+    }
+
+    // grabs the global for chunk->identifiers[indx], only hashing the identifier the first time this chunk uses it
+    inline GGlobal& getGlobal(GChunk* chunk, int indx) {
+        GChunk::GGlobalCache& cache = chunk->globalCache[indx];
+        if (cache.stateId != stateId) {
+            cache.slot = getGlobalSlot(chunk->identifiers[indx]);
+            cache.stateId = stateId;
+        }
+        return globals[cache.slot];
+    }
+
     // determins falsey-ness
     inline static bool isFalsey(GValue v) {
         return ISGVALUENIL(v) || (ISGVALUEBOOL(v) && !READGVALUEBOOL(v));
@@ -1696,6 +3425,7 @@ private:
             GObjectUpvalue* upval = openUpvalueList;
             upval->closed = *upval->val; // copy upvalue to closed GValue
             upval->val = &upval->closed; // update refernce to itself
+            Gavel::writeBarrier((GObject*)upval, upval->closed);
             openUpvalueList = upval->nextUpval; // update list
         }
     }
@@ -1732,71 +3462,103 @@ private:
         return stat;
     }
 
+    /* run()
+        Executes the current frame until it returns. Calls to other closures don't recurse, they just push a frame and swap frame & currentChunk, 
+        returning from them swaps them back. C functions & prototables still go through call().
+    */
     GStateStatus run() {
-        GCallFrame* frame = stack.getFrame();
+        Gavel::GIsolateScope isolateScope(isolate);
+        GCallFrame* const entryFrame = stack.getFrame();
+        GCallFrame* frame = entryFrame;
         GChunk* currentChunk = frame->closure->val->val; // sets currentChunk to our currently-executing chunk        
+#ifdef GAVEL_COMPUTEDGOTO
+        // MUST be in the same order as the OPCODE enum!
+        static const void* dispatchTable[] = {
+            &&LABEL_OP_LOADCONST, &&LABEL_OP_DEFINEGLOBAL, &&LABEL_OP_GETGLOBAL, &&LABEL_OP_SETGLOBAL, &&LABEL_OP_GETBASE, &&LABEL_OP_SETBASE,
+            &&LABEL_OP_GETUPVAL, &&LABEL_OP_SETUPVAL, &&LABEL_OP_CLOSURE, &&LABEL_OP_CLOSE, &&LABEL_OP_POP,
+            &&LABEL_OP_IFJMP, &&LABEL_OP_CNDNOTJMP, &&LABEL_OP_CNDJMP, &&LABEL_OP_JMP, &&LABEL_OP_JMPBACK, &&LABEL_OP_CALL,
+            &&LABEL_OP_INDEX, &&LABEL_OP_NEWINDEX, &&LABEL_OP_FOREACH,
+            &&LABEL_OP_EQUAL, &&LABEL_OP_GREATER, &&LABEL_OP_LESS, &&LABEL_OP_EQUALRK, &&LABEL_OP_GREATERRK, &&LABEL_OP_LESSRK,
+            &&LABEL_OP_NEGATE, &&LABEL_OP_NOT, &&LABEL_OP_LEN, &&LABEL_OP_ADD, &&LABEL_OP_SUB, &&LABEL_OP_MUL, &&LABEL_OP_DIV, &&LABEL_OP_MOD,
+            &&LABEL_OP_ADDRK, &&LABEL_OP_SUBRK, &&LABEL_OP_MULRK, &&LABEL_OP_DIVRK, &&LABEL_OP_MODRK,
+            &&LABEL_OP_INC, &&LABEL_OP_DEC,
+            &&LABEL_OP_CONCAT,
+            &&LABEL_OP_GETBASE2, &&LABEL_OP_ADDK, &&LABEL_OP_INCLOCAL, &&LABEL_OP_EQJMP, &&LABEL_OP_LTJMP, &&LABEL_OP_GTJMP,
+            &&LABEL_OP_TRUE, &&LABEL_OP_FALSE, &&LABEL_OP_NIL, &&LABEL_OP_NEWTABLE,
+            &&LABEL_OP_RETURN, &&LABEL_OP_END
+        };
+        static_assert(sizeof(dispatchTable) / sizeof(void*) == OP_END + 1, "dispatchTable is missing an opcode!");
+#endif
+
+        // the switch is only used to enter the loop & after an instruction uses 'break' (which re-checks our status), every other instruction uses DISPATCH()
         while (status == GSTATE_OK) 
         {
             INSTRUCTION inst = *(frame->pc)++; // gets current executing instruction and increment
+            COUNT_INSTRUCTION();
             DEBUGLOG(std::cout << "OP: " << GChunk::getOpCodeName(GET_OPCODE(inst)) << std::endl);
+#ifdef GAVEL_COMPUTEDGOTO
+            goto *dispatchTable[GET_OPCODE(inst)];
+#endif
             switch (GET_OPCODE(inst))
             {   
-                case OP_LOADCONST: { // iAx -- loads chunk->consts[Ax] onto the stack
+                VMCASE(OP_LOADCONST): { // iAx -- loads chunk->consts[Ax] onto the stack
                     DEBUGLOG(std::cout << "loading constant " << currentChunk->constants[GETARG_Ax(inst)].toString() << std::endl);
                     stack.push(currentChunk->constants[GETARG_Ax(inst)]);
-                    break;
+                    DISPATCH();
                 }
-                case OP_DEFINEGLOBAL: {
-                    GValue newVal = stack.pop();
-                    GObjectString* id = currentChunk->identifiers[GETARG_Ax(inst)];
-                    DEBUGLOG(std::cout << "defining '" << id->toString() << "' to " << newVal.toString() << std::endl);
-                    globals.setIndex(id, newVal);
-                    break;
+                VMCASE(OP_DEFINEGLOBAL): {
+                    GGlobal& global = getGlobal(currentChunk, GETARG_Ax(inst));
+                    global.val = stack.pop();
+                    global.defined = true;
+                    DEBUGLOG(std::cout << "defining '" << global.id->toString() << "' to " << global.val.toString() << std::endl);
+                    DISPATCH();
                 }
-                case OP_GETGLOBAL: {
-                    GObjectString* id = currentChunk->identifiers[GETARG_Ax(inst)];
-                    DEBUGLOG(std::cout << "grabbing '" << id->toString() << "'" << std::endl);
-                    stack.push(globals.getIndex(id));
-                    break;
+                VMCASE(OP_GETGLOBAL): {
+                    GGlobal& global = getGlobal(currentChunk, GETARG_Ax(inst));
+                    DEBUGLOG(std::cout << "grabbing '" << global.id->toString() << "'" << std::endl);
+                    stack.push(global.val); // undefined globals are nil
+                    DISPATCH();
                 }
-                case OP_SETGLOBAL: {
-                    GValue newVal = stack.getTop(0);
-                    GObjectString* id = currentChunk->identifiers[GETARG_Ax(inst)];
+                VMCASE(OP_SETGLOBAL): {
+                    GGlobal& global = getGlobal(currentChunk, GETARG_Ax(inst));
                     // if global didn't exist, throw objection!
-                    if (!globals.checkSetIndex(id, newVal)) {
-                        throwObjection("'" + id->toString() + "' does not exist!");
+                    if (!global.defined) {
+                        throwObjection("'" + global.id->toString() + "' does not exist!");
+                        break;
                     }
+                    global.val = stack.getTop(0);
                     break;
                 }
-                case OP_GETBASE: {
+                VMCASE(OP_GETBASE): {
                     int indx = GETARG_Ax(inst);
                     GValue local = stack.getBase(indx);
                     DEBUGLOG(stack.printStack());
                     DEBUGLOG(std::cout << "getting local at stack[base-" << indx << "] : " << local.toString() << std::endl);
                     stack.push(local);
-                    break;
+                    DISPATCH();
                 }
-                case OP_SETBASE: {
+                VMCASE(OP_SETBASE): {
                     int indx = GETARG_Ax(inst);
                     GValue val = stack.getTop(0); // gets value off of stack
                     DEBUGLOG(std::cout << "setting local at stack[base-" << indx << "] to " << val.toString() << std::endl);
                     stack.setBase(indx, val);
-                    break;
+                    DISPATCH();
                 }
-                case OP_GETUPVAL: {
+                VMCASE(OP_GETUPVAL): {
                     int indx = GETARG_Ax(inst);
                     DEBUGLOG(std::cout << "grabbing upvalue[" << indx << "] " << (frame->closure->upvalues[indx]->val)->toString() << std::endl);
                     stack.push(*frame->closure->upvalues[indx]->val);
-                    break;
+                    DISPATCH();
                 }
-                case OP_SETUPVAL: {
-                    int indx = GETARG_Ax(inst);
-                    *frame->closure->upvalues[indx]->val = stack.getTop(0);
-                    break;
+                VMCASE(OP_SETUPVAL): {
+                    GObjectUpvalue* upval = frame->closure->upvalues[GETARG_Ax(inst)];
+                    *upval->val = stack.getTop(0);
+                    Gavel::writeBarrier((GObject*)upval, *upval->val);
+                    DISPATCH();
                 }
-                case OP_CLOSURE: {
+                VMCASE(OP_CLOSURE): {
                     // grabs function from constants
-                    GObjectFunction* func = (GObjectFunction*)(currentChunk->constants[GETARG_Ax(inst)]).val.obj;
+                    GObjectFunction* func = (GObjectFunction*)READGVALUEOBJ(currentChunk->constants[GETARG_Ax(inst)]);
                     // creates new closure
                     GObjectClosure* closure = new GObjectClosure(func);
                     stack.push(GValue((GObject*)closure));
@@ -1822,85 +3584,108 @@ private:
                                 return GSTATE_RUNTIME_OBJECTION;
                         }
                     }
-                    Gavel::checkGarbage();
-                    break;
+                    CHECK_GARBAGE();
+                    DISPATCH();
                 }
-                case OP_CLOSE: { // iAx - Closes local at stack[base-Ax] to the heap, doesn't pop however.
+                VMCASE(OP_CLOSE): { // iAx - Closes local at stack[base-Ax] to the heap, doesn't pop however.
                     int localIndx = GETARG_Ax(inst);
                     closeUpvalues(frame->basePointer + localIndx);
-                    break;
+                    DISPATCH();
                 }
-                case OP_POP: {
+                VMCASE(OP_POP): {
                     int ax = GETARG_Ax(inst);
                     DEBUGLOG(stack.printStack());
                     DEBUGLOG(std::cout << "popping stack[top] " << ax << " times" << std::endl);
                     stack.pop(ax); // pops whatever is on the stack * Ax
-                    break;
+                    DISPATCH();
                 }
-                case OP_IFJMP: { // if stack.pop() == false, jmp
+                VMCASE(OP_IFJMP): { // if stack.pop() == false, jmp
                     int offset = GETARG_Ax(inst);
                     GValue val = stack.pop(); // NOTE: *DOES* pop the value 
                     if (isFalsey(val)) {
                         DEBUGLOG(std::cout << "stack[top] is false, JMPing by " << offset << " instructions" << std::endl);
                         frame->pc += offset; // perform the jump
                     }
-                    break;
+                    DISPATCH();
                 }
-                case OP_CNDNOTJMP: { // if stack[top] == false, jmp
+                VMCASE(OP_CNDNOTJMP): { // if stack[top] == false, jmp
                     int offset = GETARG_Ax(inst);
                     GValue val = stack.getTop(0); // NOTE: does *NOT POP THE VALUE!* 
                     if (isFalsey(val)) {
                         DEBUGLOG(std::cout << "stack[top] is false, JMPing by " << offset << " instructions" << std::endl);
                         frame->pc += offset; // perform the jump
                     }
-                    break;
+                    DISPATCH();
                 }
-                case OP_CNDJMP: {
+                VMCASE(OP_CNDJMP): {
                     int offset = GETARG_Ax(inst);
                     GValue val = stack.getTop(0); // NOTE: does *NOT POP THE VALUE!* 
                     if (!isFalsey(val)) {
                         DEBUGLOG(std::cout << "stack[top] is true, JMPing by " << offset << " instructions" << std::endl);
                         frame->pc += offset; // perform the jump
                     }
-                    break;
+                    DISPATCH();
                 }
-                case OP_JMP: {
+                VMCASE(OP_JMP): {
                     int offset = GETARG_Ax(inst);
                     DEBUGLOG(std::cout << "JMPing by " << offset << " instructions" << std::endl);
                     frame->pc += offset; // perform the jump
-                    break;
+                    DISPATCH();
                 }
-                case OP_JMPBACK: {
+                VMCASE(OP_JMPBACK): {
                     int offset = -GETARG_Ax(inst);
                     DEBUGLOG(std::cout << "JMPing by " << offset << " instructions" << std::endl);
                     frame->pc += offset; // perform the jump
-                    break;
+                    output.tick(); // every loop comes back through here, so buffered output still shows up while one runs for a while
+                    DISPATCH();
                 }
-                case OP_CALL: {
+                VMCASE(OP_CALL): {
                     int args = GETARG_Ax(inst);
+                    GValue val = stack.getTop(args);
+
+                    // script closures are ran in this loop, everything else goes through call()
+                    if (ISGVALUECLOSURE(val)) {
+                        GObjectClosure* closure = reinterpret_cast<GObjectClosure*>(READGVALUEOBJ(val));
+                        if (args != closure->val->getArgs()) {
+                            throwObjection("Function expected " + std::to_string(closure->val->getArgs()) + " args!");
+                            break;
+                        }
+
+                        if (!stack.pushFrame(closure, args)) { // callstack Overflow !
+                            throwObjection("PANIC! CallStack Overflow!");
+                            break;
+                        }
+
+                        frame = stack.getFrame();
+                        currentChunk = closure->val->val;
+                        CHECK_GARBAGE();
+                        DISPATCH();
+                    }
+
                     call(args);
-                    Gavel::checkGarbage();
+                    CHECK_GARBAGE();
                     break;
                 }
-                case OP_INDEX: {
-                    GValue indx = stack.pop(); // stack[top]
+                VMCASE(OP_INDEX): {
+                    GValue indx = Gavel::flattenValue(stack.pop()); // stack[top]
                     GValue tbl = stack.pop(); // stack[top-1]
 
                     if (ISGVALUEBASETABLE(tbl)) {
-                        stack.push(reinterpret_cast<GObjectTableBase*>(tbl.val.obj)->getIndex(indx));
+                        stack.push(reinterpret_cast<GObjectTableBase*>(READGVALUEOBJ(tbl))->getIndex(indx));
                     } else {
                         throwObjection("Cannot index non-table value " + tbl.toStringDataType());
+                        break;
                     }
-                    break;
+                    DISPATCH();
                 }
-                case OP_NEWINDEX: {
+                VMCASE(OP_NEWINDEX): {
                     GValue newVal = stack.pop(); // stack[top]
-                    GValue indx = stack.pop(); // stack[top-1]
+                    GValue indx = Gavel::flattenValue(stack.pop()); // stack[top-1]
                     GValue tbl = stack.pop(); // stack[top-2]
 
                     if (ISGVALUETABLE(tbl) || ISGVALUEPROTOTABLE(tbl)) {
-                        reinterpret_cast<GObjectTableBase*>(tbl.val.obj)->setIndex(indx, newVal);
-                    } else if (ISGVALUESTRING(tbl)) {
+                        reinterpret_cast<GObjectTableBase*>(READGVALUEOBJ(tbl))->setIndex(indx, newVal);
+                    } else if (ISGVALUESTRING(tbl) || ISGVALUEROPE(tbl)) {
                         // do nothing, no error, just act like it never happened. hey, don't blame me, javascript does it too!
 
                         // todo??? maybe???
@@ -1911,11 +3696,13 @@ private:
 
                     // for compatibility with all the other set operators
                     stack.push(newVal);
-                    break;
+                    CHECK_GARBAGE(); // the table might've grown
+                    DISPATCH();
                 }
-                case OP_FOREACH: {
+                VMCASE(OP_FOREACH): {
                     GValue closureVal = stack.pop(); // stack[top] GObjectClosure we call for each iteration
-                    GValue top = stack.pop(); // stack[top-1] GObjectTable
+                    GValue top = Gavel::flattenValue(stack.getTop(0)); // stack[top-1] GObjectTable, we leave it on the stack so the gc can still see it
+                    stack.setTop(0, top);
 
                     // no prototable support (too bad so sad)
                     if (!(ISGVALUETABLE(top) || ISGVALUESTRING(top)) || !ISGVALUECLOSURE(closureVal)) { // make sure they actually gave us a table && chunk those crafty scripters
@@ -1923,7 +3710,7 @@ private:
                         break;
                     }
 
-                    GObjectClosure* closure = reinterpret_cast<GObjectClosure*>(closureVal.val.obj);
+                    GObjectClosure* closure = reinterpret_cast<GObjectClosure*>(READGVALUEOBJ(closureVal));
                     GStateStatus stat = GSTATE_OK;
                     // since callValueFunction actually does a lot of work that we don't need (cleaning the stack, popping return values, etc.) we have a mini-call inlined here.
                     // it reuses the same call frame and local stack. this makes it very very a lot fast.
@@ -1935,26 +3722,19 @@ private:
                     }
                     
                     if (ISGVALUETABLE(top)) {
-                        for (auto pair : READGVALUETABLE(top).hashTable) {
+                        GObjectTable* tbl = reinterpret_cast<GObjectTable*>(READGVALUEOBJ(top));
+                        GValue key, value;
+                        // next() is safe to use even if the body adds to the table
+                        for (uint32_t i = 0; tbl->next(i, key, value);) {
                             // push key and value locals. compiler assumes these are already on the stack before we enter the function
-                            stack.setBase(1, pair.first.key); // key
-                            stack.setBase(2, pair.second); // value
+                            stack.setBase(1, key); // key
+                            stack.setBase(2, value); // value
                             stat = run(); // runs the chunk
 
-                            switch (stat) {
-                                case GSTATE_RETURN: {
-                                    // clean up stack, pass GSTATE_RETURN signal back to callValueFunction to handle our return
-                                    GValue retResult = stack.pop();
-                                    closeUpvalues(stack.getFrame()->basePointer); // closes parameters (if they are upvalues)
-                                    stack.popFrame(); // pops the frame and sets the top of the stack back to the base position
-                                    stack.push(retResult);
-                                    return GSTATE_RETURN;
-                                }
-                                case GSTATE_RUNTIME_OBJECTION: 
-                                    return GSTATE_RUNTIME_OBJECTION;
-                                default:
-                                    break;
-                            }
+                            if (stat == GSTATE_RUNTIME_OBJECTION)
+                                return GSTATE_RUNTIME_OBJECTION;
+                            if (stat == GSTATE_RETURN) // the body returned, so we return from our frame too (handled after the loop)
+                                break;
                             
                             // pop return value (ALL functions are required to return something), we'll reuse the stack frame so reset it
                             stack.pop();
@@ -1969,20 +3749,10 @@ private:
                             stack.setBase(2, CREATECONST_CHARACTER(READGVALUESTRING(top)[i])); // value
                             stat = run(); // runs the chunk
 
-                            switch (stat) {
-                                case GSTATE_RETURN: {
-                                    // clean up stack, pass GSTATE_RETURN signal back to callValueFunction to handle our return
-                                    GValue retResult = stack.pop();
-                                    closeUpvalues(stack.getFrame()->basePointer); // closes parameters (if they are upvalues)
-                                    stack.popFrame(); // pops the frame and sets the top of the stack back to the base position
-                                    stack.push(retResult);
-                                    return GSTATE_RETURN;
-                                }
-                                case GSTATE_RUNTIME_OBJECTION: 
-                                    return GSTATE_RUNTIME_OBJECTION;
-                                default:
-                                    break;
-                            }
+                            if (stat == GSTATE_RUNTIME_OBJECTION)
+                                return GSTATE_RUNTIME_OBJECTION;
+                            if (stat == GSTATE_RETURN) // the body returned, so we return from our frame too (handled after the loop)
+                                break;
                             
                             // pop return value (ALL functions are required to return something), we'll reuse the stack frame so reset it
                             stack.pop();
@@ -1990,63 +3760,96 @@ private:
                         }
                     }
 
+                    if (stat == GSTATE_RETURN) {
+                        // clean up the foreach frame, then return from the frame the foreach is in with the same return value
+                        GValue retResult = stack.pop();
+                        closeUpvalues(stack.getFrame()->basePointer); // closes parameters (if they are upvalues)
+                        stack.popFrame(); // pops the frame and sets the top of the stack back to the base position
+                        stack.push(retResult);
+                        RETURN_FRAME(GSTATE_RETURN);
+                    }
+
                     stack.popFrame(); // pops the call frame, like nothing happened :)
+                    stack.pop(); // pops the table/string
                     break;
                 }
-                case OP_EQUAL: {
+                VMCASE(OP_EQUAL): {
                     GValue n1 = stack.pop();
                     GValue n2 = stack.pop();
                     stack.push(n1.equals(n2)); // push result
-                    break;
+                    DISPATCH();
+                }
+                VMCASE(OP_LESS):       { BINARY_OP(<); DISPATCH(); }
+                VMCASE(OP_GREATER):    { BINARY_OP(>); DISPATCH(); }
+                VMCASE(OP_EQUALRK): {
+                    SETRA(GValue(READRK(GETARG_B(inst)).equals(READRK(GETARG_C(inst)))));
+                    DISPATCH();
                 }
-                case OP_LESS:       { BINARY_OP(<); break; }
-                case OP_GREATER:    { BINARY_OP(>); break; }
-                case OP_NEGATE: {
+                VMCASE(OP_LESSRK):     { RK_BINARY_OP(<); DISPATCH(); }
+                VMCASE(OP_GREATERRK):  { RK_BINARY_OP(>); DISPATCH(); }
+                VMCASE(OP_NEGATE): {
                     GValue val = stack.pop();
-                    if (val.type != GAVEL_TNUMBER){
+                    if (!ISGVALUENUMBER(val)){
                         throwObjection("Cannot negate non-number value " + val.toStringDataType() + "!");
                         break;
                     }
-                    stack.push(CREATECONST_NUMBER(-val.val.number));
-                    break;
+                    stack.push(CREATECONST_NUMBER(-READGVALUENUMBER(val)));
+                    DISPATCH();
                 }
-                case OP_NOT: {
+                VMCASE(OP_NOT): {
                     stack.push(isFalsey(stack.pop()));
-                    break;
+                    DISPATCH();
                 }
-                case OP_LEN: {
+                VMCASE(OP_LEN): {
                     GValue Val = stack.pop();
 
                     if (ISGVALUEBASETABLE(Val)) {
                         // push the size of the table/prototable onto the stack
-                        stack.push(CREATECONST_NUMBER(reinterpret_cast<GObjectTableBase*>(Val.val.obj)->getLength()));
+                        stack.push(CREATECONST_NUMBER(reinterpret_cast<GObjectTableBase*>(READGVALUEOBJ(Val))->getLength()));
                     } else {
                         throwObjection("Expected a [TABLE] or [STRING]!");
                         break;
                     }
 
-                    break;
+                    DISPATCH();
                 }
-                case OP_ADD:    { BINARY_OP(+); break; }
-                case OP_SUB:    { BINARY_OP(-); break; }
-                case OP_MUL:    { BINARY_OP(*); break; }
-                case OP_DIV:    { BINARY_OP(/); break; }
-                case OP_MOD: {
+                VMCASE(OP_ADD):    { BINARY_OP(+); DISPATCH(); }
+                VMCASE(OP_SUB):    { BINARY_OP(-); DISPATCH(); }
+                VMCASE(OP_MUL):    { BINARY_OP(*); DISPATCH(); }
+                VMCASE(OP_DIV):    { BINARY_OP(/); DISPATCH(); }
+                VMCASE(OP_MOD): {
                     // grab numbers
                     GValue num1 = stack.pop();
                     GValue num2 = stack.pop();
 
                     // sanity check
-                    if (num1.type != GAVEL_TNUMBER || num2.type != GAVEL_TNUMBER) {
+                    if (!ISGVALUENUMBER(num1) || !ISGVALUENUMBER(num2)) {
                         throwObjection("Cannot perform arithmetic on " + num1.toStringDataType() + " and " + num2.toStringDataType());
                         break;
                     }
 
                     // use fmod to get the modulus of the two numbers
-                    stack.push(CREATECONST_NUMBER(fmod(num2.val.number, num1.val.number))); 
-                    break;
+                    stack.push(CREATECONST_NUMBER(fmod(READGVALUENUMBER(num2), READGVALUENUMBER(num1)))); 
+                    DISPATCH();
+                }
+                VMCASE(OP_ADDRK):   { RK_BINARY_OP(+); DISPATCH(); }
+                VMCASE(OP_SUBRK):   { RK_BINARY_OP(-); DISPATCH(); }
+                VMCASE(OP_MULRK):   { RK_BINARY_OP(*); DISPATCH(); }
+                VMCASE(OP_DIVRK):   { RK_BINARY_OP(/); DISPATCH(); }
+                VMCASE(OP_MODRK): {
+                    GValue num1 = READRK(GETARG_B(inst));
+                    GValue num2 = READRK(GETARG_C(inst));
+
+                    // sanity check
+                    if (!ISGVALUENUMBER(num1) || !ISGVALUENUMBER(num2)) {
+                        throwObjection("Cannot perform arithmetic on " + num2.toStringDataType() + " and " + num1.toStringDataType());
+                        break;
+                    }
+
+                    SETRA(CREATECONST_NUMBER(fmod(READGVALUENUMBER(num1), READGVALUENUMBER(num2))));
+                    DISPATCH();
                 }
-                case OP_INC: {
+                VMCASE(OP_INC): {
                     int type = GETARG_Ax(inst);
                     GValue num = stack.pop();
                     if (!ISGVALUENUMBER(num)) {
@@ -2060,9 +3863,9 @@ private:
                     stack.push(READGVALUENUMBER(num) + (type == 1 ? 0 : 1));
                     // then push the value that will be assigned
                     stack.push(READGVALUENUMBER(num) + 1);
-                    break;
+                    DISPATCH();
                 }
-                case OP_DEC: {
+                VMCASE(OP_DEC): {
                     int type = GETARG_Ax(inst);
                     GValue num = stack.pop();
                     if (!ISGVALUENUMBER(num)) {
@@ -2074,82 +3877,95 @@ private:
                     stack.push(READGVALUENUMBER(num) - (type == 1 ? 0 : 1));
                     // then push the value that will be assigned
                     stack.push(READGVALUENUMBER(num) - 1);
-                    break;
+                    DISPATCH();
                 }
-                case OP_CONCAT: {
-                    int num = GETARG_Ax(inst); // number of strings on the stack to concatenate
-                    std::vector<std::string> tempStrings(num); // so we don't call toString() more than once
-                    std::string tempStr;
-                    GValue temp;
-                    int size = 1; // start with 1 for the \0 terminator
-                    int indx = 0;
-
-                    // compute the size of the buffer first
-                    for (int i = 0; i < num; i++) {
-                        temp = stack.getTop(num-i-1);
-                        tempStr = temp.toString();
-
-                        tempStrings[i] = tempStr;
-                        size += tempStr.length();
+                VMCASE(OP_CONCAT): {
+                    if (!concat(GETARG_Ax(inst))) {
+                        throwObjection("memory limit exceeded");
+                        break;
                     }
-
-                    // allocate new buffer (+1 for null terminator), copy strings to buffer
-                    char strBuf[size+1];
-                    for (int i = 0; i < num; i++) {
-                        tempStr = tempStrings[i];
-
-                        // use memcpy to copy the buffer (excluding the null terminator) to strBud
-                        memcpy(strBuf + indx, tempStr.c_str(), tempStr.length());
-                        indx += tempStr.length();
+                    CHECK_GARBAGE();
+                    DISPATCH();
+                }
+                VMCASE(OP_GETBASE2): {
+                    stack.push(frame->basePointer[GETARG_A(inst)]);
+                    stack.push(frame->basePointer[GETARG_B(inst)]);
+                    DISPATCH();
+                }
+                VMCASE(OP_ADDK): {
+                    GValue num1 = currentChunk->constants[GETARG_Ax(inst)];
+                    GValue num2 = stack.pop();
+                    if (!ISGVALUENUMBER(num1) || !ISGVALUENUMBER(num2)) {
+                        throwObjection("Cannot perform arithmetic on " + num1.toStringDataType() + " and " + num2.toStringDataType());
+                        break;
+                    }
+                    stack.push(GValue(READGVALUENUMBER(num2) + READGVALUENUMBER(num1)));
+                    DISPATCH();
+                }
+                VMCASE(OP_INCLOCAL): {
+                    GValue* local = frame->basePointer + GETARG_A(inst);
+                    bool dec = GETARG_B(inst);
+                    if (!ISGVALUENUMBER(*local)) {
+                        throwObjection((dec ? "Cannot decrement on " : "Cannot increment on ") + local->toStringDataType());
+                        break;
                     }
-                    strBuf[indx] = '\0';
 
-                    // pop all of those off the stack & then push the finished string :)
-                    stack.pop(num);
-                    stack.push(CREATECONST_STRING(std::string(strBuf, size-1)));
-                    Gavel::checkGarbage();
-                    break;
+                    GValue old = *local;
+                    *local = CREATECONST_NUMBER(READGVALUENUMBER(old) + (dec ? -1 : 1));
+                    switch (GETARG_C(inst)) {
+                        case 1: stack.push(old); break;
+                        case 2: stack.push(*local); break;
+                        default: break;
+                    }
+                    DISPATCH();
+                }
+                VMCASE(OP_EQJMP): {
+                    bool res = READRK(GETARG_B(inst)).equals(READRK(GETARG_C(inst)));
+                    COMPARE_JMP(res);
+                    DISPATCH();
                 }
-                case OP_TRUE: {
+                VMCASE(OP_LTJMP):  { RK_COMPARE_JMP(<); DISPATCH(); }
+                VMCASE(OP_GTJMP):  { RK_COMPARE_JMP(>); DISPATCH(); }
+                VMCASE(OP_TRUE): {
                     DEBUGLOG(std::cout << "pushing true to the stack" << std::endl);
                     stack.push(CREATECONST_BOOL(true));
-                    break;
+                    DISPATCH();
                 }
-                case OP_FALSE: {
+                VMCASE(OP_FALSE): {
                     DEBUGLOG(std::cout << "pushing false to the stack" << std::endl);
                     stack.push(CREATECONST_BOOL(false));
-                    break;
+                    DISPATCH();
                 }
-                case OP_NIL: {
+                VMCASE(OP_NIL): {
                     DEBUGLOG(std::cout << "pushing nil to the stack" << std::endl);
                     stack.push(CREATECONST_NIL());
-                    break;
+                    DISPATCH();
                 }
-                case OP_NEWTABLE: {
+                VMCASE(OP_NEWTABLE): {
                     DEBUGLOG(std::cout << "pushing new table to the stack" << std::endl);
                     
                     int pairs = GETARG_Ax(inst);
                     GValue tbl = CREATECONST_TABLE();
+                    GObjectTable* tblObj = reinterpret_cast<GObjectTable*>(READGVALUEOBJ(tbl));
 
-                    for (int i = 0; i < pairs; i++) {
-                        // grab pair from the stack
-                        GValue val = stack.pop();
-                        GValue indx = stack.pop();
-
-                        // set the key/value pair in the table
-                        READGVALUETABLE(tbl).setIndex(indx, val);
+                    // set the key/value pairs in the order they were written, so arrays go straight into the array part
+                    GValue* pair = stack.getStackEnd() - pairs * 2;
+                    for (int i = 0; i < pairs; i++, pair += 2) {
+                        tblObj->setIndex(pair[0], pair[1]);
                     }
+                    stack.pop(pairs * 2);
 
-                    Gavel::addGarbage(reinterpret_cast<GObject*>(tbl.val.obj));
+                    Gavel::addGarbage(reinterpret_cast<GObject*>(READGVALUEOBJ(tbl)));
                     stack.push(tbl);
-                    break;
+                    CHECK_GARBAGE();
+                    DISPATCH();
                 }
-                case OP_RETURN: { // i
-                    return GSTATE_RETURN;
+                VMCASE(OP_RETURN): { // i
+                    RETURN_FRAME(GSTATE_RETURN);
                 }
-                case OP_END: { // i
+                VMCASE(OP_END): { // i
                     stack.push(CREATECONST_NIL());
-                    return GSTATE_OK;
+                    RETURN_FRAME(GSTATE_OK);
                 }
                 default:
                     throwObjection("INVALID OPCODE: " + std::to_string(GET_OPCODE(inst)));
@@ -2161,8 +3977,13 @@ private:
 
 public:
     GState* next = NULL; // internal gc use
+    Gavel::GIsolate* isolate; // where our objects live, it's made current while we run
     GStack stack;
-    GState() {}
+    GOutput output; // where print goes (see GOutput)
+#ifdef GAVEL_COUNTINSTRUCTIONS
+    size_t instructionCount = 0; // total instructions executed by this state
+#endif
+    GState(Gavel::GIsolate* iso): stateId(newStateId()), isolate(iso) {}
 
     void markRoots() {
         // marks values on the stack (locals and temporaries)
@@ -2173,7 +3994,7 @@ public:
 
         // mark closures
         GCallFrame* endCallFrame = stack.getCallStackEnd();
-        for (GCallFrame* indx = stack.getCallStackStart(); indx > endCallFrame; indx++) {
+        for (GCallFrame* indx = stack.getCallStackStart(); indx < endCallFrame; indx++) {
             Gavel::markObject((GObject*)indx->closure);
         }
 
@@ -2183,7 +4004,10 @@ public:
         }
 
         // marks globals
-        Gavel::markTable<GObjectString*>(&globals);
+        Gavel::markTable<GObjectString*>(&globalSlots);
+        for (GGlobal& global : globals) {
+            Gavel::markValue(global.val);
+        }
     }
 
     GObjectUpvalue* captureUpvalue(GValue* v) {
@@ -2214,14 +4038,19 @@ public:
 
     void printGlobals() {
         std::cout << "----[[GLOBALS]]----" << std::endl;
-        globals.printTable();
+        for (GGlobal& global : globals) {
+            if (global.defined)
+                std::cout << global.id->toString() << " : " << global.val.toString() << std::endl;
+        }
     }
 
     template <typename T>
     void setGlobal(std::string id, T val) {
+        Gavel::GIsolateScope isolateScope(isolate); // the value & the identifier have to live in our isolate
         GValue newVal = Gavel::newGValue(val);
-        GObjectString* str = Gavel::addString(id); // lookup string
-        globals.setIndex(str, newVal);
+        GGlobal& global = globals[getGlobalSlot(Gavel::addString(id))];
+        global.val = newVal;
+        global.defined = true;
     }
 
     void throwObjection(std::string err) {
@@ -2236,7 +4065,9 @@ public:
             
             // push function to objection
             GObjectFunction* currentFunction = frame->closure->val; // gets our currently-executing chunk
-            tmp.pushCall(currentFunction->getName(), currentFunction->val->lineInfo[frame->pc - &currentFunction->val->code[0]]);
+            // pc already points past the instruction that was executing
+            int pc = std::max((int)(frame->pc - &currentFunction->val->code[0]) - 1, 0);
+            tmp.pushCall(currentFunction->getName(), currentFunction->val->lineInfo[pc]);
 
 
             // if the function is embedded in another function (aka compiler-generated for OP_FOREACH)
@@ -2247,7 +4078,7 @@ public:
         } while (frame != lastFrame);
 
         GValue obj = CREATECONST_OBJECTION(tmp);
-        Gavel::addGarbage(obj.val.obj);
+        Gavel::addGarbage(READGVALUEOBJ(obj));
         
         status = GSTATE_RUNTIME_OBJECTION;
         stack.push(obj);
@@ -2263,12 +4094,16 @@ public:
     }
 
     GStateStatus start(GObjectFunction* main) {
+        // the main closure has to be made in our isolate, not whichever one the caller has current
+        Gavel::GIsolateScope isolateScope(isolate);
         // clean stack and everything
         resetState();
         GObjectClosure* closure = new GObjectClosure(main);
         Gavel::addGarbage((GObject*)closure);
         stack.push(GValue((GObject*)closure)); // pushes closure to the stack
-        return callValueFunction(closure, 0);
+        GStateStatus stat = callValueFunction(closure, 0);
+        output.flush(); // the host gets to see everything the script printed
+        return stat;
     }
 
     // resets stack, callstack and triggers a garbage collection. globals are NOT cleared
@@ -2289,14 +4124,104 @@ public:
     void resume() {
         // make sure our state is in a resumeable state
         if (status == GSTATE_YIELD) {
+            Gavel::GIsolateScope isolateScope(isolate);
             status = GSTATE_OK;
             run(); // resumes right where we left off :)
+            output.flush();
         }
     }
 
     /* call(args)
         Looks at stack[top-args], and if it is callable, call it.
     */
+    // natives only ever get flattened strings as arguments (see GObjectRope)
+    void flattenArgs(int args) {
+        GValue* arg = stack.getStackEnd() - args;
+        for (int i = 0; i < args; i++)
+            arg[i] = Gavel::flattenValue(arg[i]);
+    }
+
+    /* concat(num)
+        Pops num values & pushes them concatenated (OP_CONCAT). Short results are plain strings, long ones (& anything appended to a rope) are GObjectRopes, 
+    if the first value is the rope that wrote the end of it's buffer we just append to the buffer. Returns false (without touching the stack) if the result 
+    wouldn't fit in the memory limit.
+    */
+    bool concat(int num) {
+        GValue* operands = stack.getStackEnd() - num;
+        std::vector<std::string> tempStrings(num); // for anything that isn't a string or a rope, so we only call toString() once
+        size_t size = 0;
+
+        // compute the size of the result first
+        for (int i = 0; i < num; i++) {
+            GValue v = operands[i];
+            if (ISGVALUESTRING(v)) {
+                size += READGVALUESTRING(v).length();
+            } else if (ISGVALUEROPE(v)) {
+                size += reinterpret_cast<GObjectRope*>(READGVALUEOBJ(v))->len;
+            } else {
+                tempStrings[i] = v.toString();
+                size += tempStrings[i].length();
+            }
+        }
+
+        GObjectRope* base = ISGVALUEROPE(operands[0]) ? reinterpret_cast<GObjectRope*>(READGVALUEOBJ(operands[0])) : NULL;
+        bool inPlace = base != NULL && base->isTip();
+        bool isRope = base != NULL || size >= GSTRING_ROPEMIN;
+
+        // how much the buffer grows. appending in place doubles it when it's full (like std::string would), so that's what has to fit
+        size_t capacity = size;
+        size_t grown = size;
+        if (inPlace) {
+            capacity = size > base->buf->capacity() ? std::max(size, base->buf->capacity() * 2) : base->buf->capacity();
+            grown = capacity - base->buf->counted;
+        }
+
+        // don't even build it if it won't fit
+        if (!Gavel::reserveMemory(isRope ? grown + sizeof(GObjectRope) : size))
+            return false;
+
+        auto append = [&](std::string& out, int i) {
+            GValue v = operands[i];
+            if (ISGVALUESTRING(v)) {
+                out += READGVALUESTRING(v);
+            } else if (ISGVALUEROPE(v)) {
+                GObjectRope* rope = reinterpret_cast<GObjectRope*>(READGVALUEOBJ(v));
+                if (rope->buf.get() == &out) // appending a buffer to itself, copy it first
+                    out += rope->toString();
+                else
+                    out.append(*rope->buf, 0, rope->len);
+            } else {
+                out += tempStrings[i];
+            }
+        };
+
+        GValue result;
+        if (!isRope) {
+            // allocate the result once & append everything
+            std::string strBuf;
+            strBuf.reserve(size);
+            for (int i = 0; i < num; i++)
+                append(strBuf, i);
+            result = CREATECONST_STRING(strBuf);
+        } else {
+            std::shared_ptr<GObjectRope::GRopeBuffer> buf = inPlace ? base->buf : std::make_shared<GObjectRope::GRopeBuffer>();
+            buf->reserve(capacity);
+
+            for (int i = inPlace ? 1 : 0; i < num; i++)
+                append(*buf, i);
+
+            Gavel::resizeBuffer(buf->counted, buf->capacity());
+            GObjectRope* rope = new GObjectRope(buf, size);
+            Gavel::addGarbage((GObject*)rope);
+            result = GValue((GObject*)rope);
+        }
+
+        // pop all of those off the stack & then push the result :)
+        stack.pop(num);
+        stack.push(result);
+        return true;
+    }
+
     GStateStatus call(int args) {
         GValue val = stack.getTop(args);
 
@@ -2305,24 +4230,31 @@ public:
             return GSTATE_RUNTIME_OBJECTION;
         }
             
-        switch (val.val.obj->type) {
+        switch (READGVALUEOBJ(val)->type) {
             case GOBJECT_CLOSURE: // call closure
-                return callValueFunction(reinterpret_cast<GObjectClosure*>(val.val.obj), args);
+                return callValueFunction(reinterpret_cast<GObjectClosure*>(READGVALUEOBJ(val)), args);
             case GOBJECT_BOUNDCALL: { // c function bound to a prototable!
-                GObjectBoundCall* bCall = reinterpret_cast<GObjectBoundCall*>(val.val.obj);
+                GObjectBoundCall* bCall = reinterpret_cast<GObjectBoundCall*>(READGVALUEOBJ(val));
+                flattenArgs(args);
                 // the prototable the call belongs too will always be first on the stack
                 stack.push(GValue((GObject*)bCall->tbl));
                 args++;
 
-                // make arg vector for c function
-                std::vector<GValue> argsVector(args);
+                GValue rtnVal;
+                if (bCall->spanVar != NULL) {
+                    // the arguments are already on the stack, just point to them
+                    rtnVal = bCall->spanVar(this, {stack.getStackEnd() - args, args});
+                } else {
+                    // make arg vector for c function
+                    std::vector<GValue> argsVector(args);
+
+                    for (int i = 0; i < args; i++) {
+                        argsVector[i] = stack.getTop(args-1-i);
+                    }
 
-                for (int i = 0; i < args; i++) {
-                    argsVector[i] = stack.getTop(args-1-i);
+                    rtnVal = bCall->var(this, argsVector);
                 }
 
-                GValue rtnVal = bCall->var(this, argsVector);
-
                 if (status == GSTATE_RUNTIME_OBJECTION)
                     return status;
 
@@ -2334,24 +4266,32 @@ public:
                 break;
             }
             case GOBJECT_FUNCTION: {
-                // craft a closure and then call callValueFunction
-                GObjectClosure* cls = new GObjectClosure((GObjectFunction*)val.val.obj);
+                // craft a closure and then call callValueFunction (the host can call this directly, so make sure it goes in our isolate)
+                Gavel::GIsolateScope isolateScope(isolate);
+                GObjectClosure* cls = new GObjectClosure((GObjectFunction*)READGVALUEOBJ(val));
                 Gavel::addGarbage((GObject*)cls);
                 return callValueFunction(cls, args);
             }
             case GOBJECT_CFUNCTION: {
                 // call c function
-                GAVELCFUNC func = READGVALUECFUNCTION(val);
+                GObjectCFunction* cfunc = reinterpret_cast<GObjectCFunction*>(READGVALUEOBJ(val));
+                flattenArgs(args);
+
+                GValue rtnVal;
+                if (cfunc->spanVal != NULL) {
+                    // the arguments are already on the stack, just point to them
+                    rtnVal = cfunc->spanVal(this, {stack.getStackEnd() - args, args});
+                } else {
+                    // make arg vector for c function
+                    std::vector<GValue> argsVector(args);
 
-                // make arg vector for c function
-                std::vector<GValue> argsVector(args);
+                    for (int i = 0; i < args; i++) {
+                        argsVector[i] = stack.getTop(args-1-i);
+                    }
 
-                for (int i = 0; i < args; i++) {
-                    argsVector[i] = stack.getTop(args-1-i);
+                    rtnVal = cfunc->val(this, argsVector);
                 }
 
-                GValue rtnVal = func(this, argsVector);
-
                 if (status == GSTATE_RUNTIME_OBJECTION)
                     return status;
 
@@ -2372,113 +4312,268 @@ public:
 };
 
 #undef BINARY_OP
+#undef RETURN_FRAME
+#undef RK_BINARY_OP
+#undef READRK
+#undef SETRA
+#undef DISPATCH
+#undef VMCASE
+#undef COUNT_INSTRUCTION
 
 namespace Gavel {
-    static GTable<GObjectString*> strings;
-    static std::vector<GObject*> greyObjects; // objects that are marked grey
-    static GObject* objList = NULL; // another linked list to track our allocated objects on the heap
-    static GState* states = NULL;
-    static GChunk* chunks = NULL;
-    static size_t bytesAllocated = 0;
-    static size_t nextGc = GC_INITALMEMORYTHRESH;
-#ifdef GSTRING_INTERN
-    static size_t stringThreshGc = GC_INITIALSTRINGSTHRESH;
-#endif
+    // see getHeapStats()
+    struct GHeapStats {
+        size_t objectBytes = 0; // what the GC thinks it owns (bytesAllocated), every object it tracks plus the strings/arrays/tables they own
+        size_t youngBytes = 0; // how much of that is in the nursery
+        size_t nextGc = 0; // the next full collection starts when objectBytes gets past this
+        size_t internBytes = 0; // the intern set & the GC's own lists
+        size_t internedStrings = 0; // how many strings are in the intern set
+        size_t chunkBytes = 0; // bytecode, constants & line info of every chunk (not collected, they're freed with their function)
+        size_t poolBytes = 0; // pages reserved by GPool for GObjects, these are never given back (0 with GAVEL_NO_POOL)
+        size_t poolUsedBytes = 0; // how much of those pages is being used by GObjects (managed by the GC or not)
+        size_t largeBytes = 0; // GObjects too big for the pools
+        size_t rss = 0; // resident set size of the whole process, 0 if it can't be read on this platform
+    };
 
 #ifdef _GAVEL_INIT
 
-    void checkGarbage() {
-#ifdef GSTRING_INTERN
-        // if strings are bigger than our threshhold, clean them up. 
-        if (strings.getSize() > stringThreshGc) {
-            collectGarbage();
-            // if most of them are still being used, let more for next time
-            if (strings.getSize()*2 > stringThreshGc) {
-                stringThreshGc =  stringThreshGc + strings.getSize();
-            }
-        }
-#endif
-
-        if (bytesAllocated > nextGc) {
-            collectGarbage(); // collect the garbage
-            DEBUGGC(std::cout << "New bytesAllocated: " << bytesAllocated << std::endl);
-            if (bytesAllocated * 2 > nextGc) {
-                nextGc += bytesAllocated;
-            }
-        }
+    // turns minor collections on/off. with them off, the nursery is only swept by full collections
+    void setGenerational(bool enabled) {
+        isolate->generational = enabled;
     }
 
-    // a very-small amount of string interning is done, however the GTable implementation still uses ->equals(). This will help in the future when string interning becomes a priority
-    GObjectString* addString(std::string str) {
-        GObjectString* newStr = new GObjectString(str);
-#ifdef GSTRING_INTERN
-        GObjectString* key = (GObjectString*)strings.findExistingKey(newStr);
-        if (key == NULL) {
-            strings.setIndex(newStr, CREATECONST_NIL());
-            addGarbage(newStr); // add it to our GC AFTER so we don't make out gc clean it up by accident :sob:
-            return newStr;
-        }
+    // sets how long (in microseconds) a slice of a full collection should take, 0 makes full collections stop-the-world
+    void setMaxPause(size_t microseconds) {
+        isolate->maxPause = microseconds;
+    }
 
-        delete newStr;
-        key->is_interned = true;
-        return key;
+    // true if the sweeper thread is working on the current isolate's sweepList
+    inline bool isBackgroundSweeping() {
+#ifndef GAVEL_NO_GCTHREADS
+        return isolate->sweeper.joinable();
 #else
-        addGarbage(newStr);
-        return newStr;
+        return false;
 #endif
     }
 
-    // creates a new GState and adds to the states linked list
-    GState* newState() {
-        GState* st = new GState();
-
-        if (states != NULL) {
-            st->next = states;
-        }
+    // sets the lowest the full collection threshold can go (& where it starts)
+    void setMinThreshold(size_t bytes) {
+        isolate->minThreshold = bytes;
+        if (isolate->gcPhase == GC_IDLE && isolate->nextGc < bytes)
+            isolate->nextGc = bytes;
+    }
 
-        states = st;
-        return st;
+    // sets how big the heap can grow (in percent of what survived the last full collection) before the next one starts. anything under 100 is treated as 100
+    void setGrowth(size_t percent) {
+        isolate->growth = percent < 100 ? 100 : percent;
     }
 
-    // creates a new GChunk and adds to the chunk linked list
-    GChunk* newChunk() {
-        GChunk* ch = new GChunk();
+    // sets how many bytes can be allocated before a minor collection
+    void setNurserySize(size_t bytes) {
+        isolate->nurserySize = bytes;
+    }
 
-        if (chunks != NULL) {
-            ch->next = chunks;
-        }
+    /* setMemoryLimit(bytes)
+        Caps how much memory the current isolate's objects can use, 0 removes the cap. Every state in the isolate shares it, so give each tenant it's own 
+    isolate if they need their own limit. Scripts that go over it get a "memory limit exceeded" objection instead of the allocation failing.
+    */
+    void setMemoryLimit(size_t bytes) {
+        isolate->memoryLimit = bytes;
+    }
 
-        chunks = ch;
-        return ch;
+    GGCStats getGCStats() {
+        return isolate->stats;
     }
 
-    void freeChunk(GChunk* ch) {
-        GChunk* currentChunk = chunks;
-        GChunk* prev = NULL;
+    // times the GC work done while it's in scope & adds it to the current isolate's stats
+    struct GPauseTimer {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        while (currentChunk != ch && currentChunk != NULL) {
-            prev = currentChunk;
-            currentChunk = currentChunk->next;
+        ~GPauseTimer() {
+            double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            GGCStats& stats = isolate->stats;
+            stats.pauses++;
+            stats.totalPause += elapsed;
+            if (elapsed > stats.longestPause)
+                stats.longestPause = elapsed;
         }
+    };
 
-        if (currentChunk == NULL) {
-            // doesn't exist, so go ahead and delete it anyways
-            delete ch;
-            return;
-        }
+    void startCycle();
+    void gcStep();
+    void finishCollection();
 
-        // unlink it from the list!
-        if (prev != NULL) 
+    void collectGarbage();
+
+    /* reserveMemory(bytes)
+        Checks if [bytes] more can be allocated without going over the memory limit, forcing a full collection first if it would. Returns false if there still
+    isn't room, the VM turns that into a "memory limit exceeded" objection.
+    */
+    bool reserveMemory(size_t bytes) {
+        if (isolate->memoryLimit == 0 || isolate->bytesAllocated + bytes <= isolate->memoryLimit)
+            return true;
+
+        collectGarbage();
+        return isolate->bytesAllocated + bytes <= isolate->memoryLimit;
+    }
+
+    // does whatever garbage collection work is due, returns false if the isolate is over it's memory limit even after collecting
+    bool checkGarbage() {
+        if (isolate->memoryLimit != 0 && isolate->bytesAllocated > isolate->memoryLimit)
+            return reserveMemory(0);
+
+        // no minor collections while marking, the nursery is part of the full collection
+        bool minor = isolate->generational && isolate->gcPhase != GC_MARK && isolate->youngBytes > isolate->nurserySize;
+        bool full = isolate->gcPhase == GC_IDLE ? isolate->bytesAllocated > isolate->nextGc : isolate->gcDebt > GC_STEPSIZE || isolate->bytesAllocated > isolate->nextGc * 2;
+        if (!minor && !full)
+            return true; // nothing to do, don't bother with the timer
+
+        GPauseTimer pause;
+        if (minor)
+            collectYoung(); // everything that survives is promoted, so this might start a full collection below
+
+        if (isolate->gcPhase == GC_IDLE) {
+            if (isolate->bytesAllocated > isolate->nextGc) {
+                startCycle();
+                gcStep();
+            }
+        } else if (isolate->gcDebt > GC_STEPSIZE || isolate->bytesAllocated > isolate->nextGc * 2) {
+            // if we're allocating way faster than we're collecting, just finish it
+            if (isolate->bytesAllocated > isolate->nextGc * 2)
+                finishCollection();
+            else
+                gcStep();
+        }
+        return true;
+    }
+
+    // looks up the string in the intern set (if GSTRING_INTERN is defined) by it's contents, only allocating a new GObjectString if it doesn't exist yet
+    GObjectString* addString(std::string_view str) {
+#ifdef GSTRING_INTERN
+        int hash = GObjectString::hashString(str);
+        GObjectString* key = isolate->strings.findString(str, hash);
+        if (key != NULL) {
+            key->is_interned = true;
+            // it might be dead & waiting to be swept, marking it keeps the sweep from freeing it. (the background sweeper already took dead ones out of the set)
+            if (isolate->gcPhase == GC_SWEEP && !isBackgroundSweeping())
+                key->setMarked(true);
+            return key;
+        }
+
+        GObjectString* newStr = GObjectString::create(str, hash);
+        isolate->strings.setIndex(newStr, CREATECONST_NIL());
+        addGarbage(newStr); // add it to our GC AFTER so we don't make out gc clean it up by accident :sob:
+        return newStr;
+#else
+        GObjectString* newStr = GObjectString::create(str); // hashed lazily
+
+        addGarbage(newStr);
+        return newStr;
+#endif
+    }
+
+    // makes a new isolate, with it's own heap. (see GIsolate)
+    GIsolate* newIsolate() {
+        return new GIsolate();
+    }
+
+    // makes iso the current isolate of the calling thread. NULL switches back to the default one
+    void setIsolate(GIsolate* iso) {
+        isolate = iso != NULL ? iso : &defaultIsolate;
+    }
+
+    GIsolate* getIsolate() {
+        return isolate;
+    }
+
+    /* freeIsolate(iso)
+        Frees every state still in the isolate, everything they were using & the pages of it's pool. Delete the functions you compiled in it first!
+    */
+    void freeIsolate(GIsolate* iso) {
+        if (iso == NULL || iso == &defaultIsolate)
+            return;
+
+        GIsolate* last = isolate != iso ? isolate : &defaultIsolate;
+        isolate = iso;
+
+        while (iso->states != NULL) {
+            GState* st = iso->states;
+            iso->states = st->next;
+            delete st;
+        }
+
+        // with nothing left to mark, this frees every object
+        collectGarbage();
+#ifndef GAVEL_NO_POOL
+        iso->pool.freePages();
+#endif
+
+        isolate = last;
+        delete iso;
+    }
+
+    /* newState(iso)
+        Creates a new GState in iso (or the calling thread's current isolate if it's NULL), & makes that the current isolate of the calling thread so you can 
+    load libraries & compile scripts for it right away.
+    */
+    GState* newState(GIsolate* iso) {
+        if (iso != NULL)
+            isolate = iso;
+
+        GState* st = new GState(isolate);
+
+        if (isolate->states != NULL) {
+            st->next = isolate->states;
+        }
+
+        isolate->states = st;
+        return st;
+    }
+
+    // creates a new GChunk and adds to the chunk linked list
+    GChunk* newChunk() {
+        GChunk* ch = new GChunk();
+
+        if (isolate->chunks != NULL) {
+            ch->next = isolate->chunks;
+        }
+
+        isolate->chunks = ch;
+        return ch;
+    }
+
+    void freeChunk(GChunk* ch) {
+        // the chunk's constants could be waiting to be blackened, so finish that before they're freed
+        if (isolate->gcPhase == GC_MARK)
+            traceReferences();
+
+        GChunk* currentChunk = isolate->chunks;
+        GChunk* prev = NULL;
+
+        while (currentChunk != ch && currentChunk != NULL) {
+            prev = currentChunk;
+            currentChunk = currentChunk->next;
+        }
+
+        if (currentChunk == NULL) {
+            // doesn't exist, so go ahead and delete it anyways
+            delete ch;
+            return;
+        }
+
+        // unlink it from the list!
+        if (prev != NULL) 
             prev->next = currentChunk->next;
         else 
-            chunks = currentChunk->next;
+            isolate->chunks = currentChunk->next;
         
         // finally, delete the chunk!
         delete ch;
     }
 
     void freeState(GState* st) {
-        GState* currentState = states;
+        GIsolateScope scope(st->isolate);
+        GState* currentState = isolate->states;
         GState* prev = NULL;
 
         while (currentState != st && currentState != NULL) {
@@ -2495,7 +4590,7 @@ namespace Gavel {
         if (prev != NULL)
             prev->next = currentState->next;
         else
-            states = currentState->next;
+            isolate->states = currentState->next;
 
         // finally, delete the state!
         delete st;
@@ -2506,47 +4601,86 @@ namespace Gavel {
 
 // =============================================================[[GARBAGE COLLECTION]]=============================================================
 
+    /* GHeapWalker
+        Records the graph for writeHeapSnapshot(). It walks the heap with the marker's own code (markRoots(), blackenObject(), GProto::mark()), markObject() 
+    just hands every reference to visit() instead of marking it. Nodes are numbered in the order they're found, edges go from the node being walked to 
+    what it references.
+    */
+    struct GHeapWalker {
+        std::unordered_map<GObject*, uint32_t> ids;
+        std::vector<GObject*> objects; // NULL for the root nodes (the states & chunks)
+        std::unordered_map<uint32_t, std::string> rootNames;
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+        uint32_t from = 0;
+
+        uint32_t addRoot(std::string name) {
+            objects.push_back(NULL);
+            rootNames[objects.size() - 1] = name;
+            return objects.size() - 1;
+        }
+
+        void visit(GObject* o) {
+            auto found = ids.find(o);
+            uint32_t id;
+            if (found == ids.end()) {
+                id = objects.size();
+                ids[o] = id;
+                objects.push_back(o);
+            } else {
+                id = found->second;
+            }
+            edges.push_back({from, id});
+        }
+    };
+
     void markObject(GObject* o) {
-        if (o == NULL || o->isGray) // make sure it exists & we havent marked it yet
+        if (o == NULL)
+            return;
+
+        if (heapWalker != NULL) {
+            heapWalker->visit(o);
+            return;
+        }
+
+        if (o->isMarked()) // make sure we havent marked it yet
+            return;
+
+        // minor collections treat old objects as alive, the ones that point to young objects are in the remembered set
+        if (isolate->minorCollection && o->isOld)
+            return;
+
+#ifndef GAVEL_NO_GCTHREADS
+        // other threads could be marking too, so whoever sets the mark bit first gets to blacken it
+        if (markWorker != NULL) {
+            if (o->tryMark())
+                markWorker->stack.push_back(o);
             return;
+        }
+#endif
 
         DEBUGGC(std::cout << "marking " << o->toString() << std::endl);
         
         // mark grey and keep track of it
-        o->isGray = true;
-        greyObjects.push_back(o);
+        o->setMarked(true);
+        isolate->greyObjects.push_back(o);
     }
     
     void markValue(GValue val) {
         // if it's an object, mark it
         if (ISGVALUEOBJ((val)))
-            markObject((GObject*)val.val.obj);
+            markObject((GObject*)READGVALUEOBJ(val));
     }
 
     template <typename T>
     void markTable(GTable<T>* tbl) {
-        for (auto pair : tbl->hashTable) {
+        for (auto& node : *tbl) {
             if constexpr (std::is_same<T, GObjectString*>() || std::is_same<T, GObject*>()) {
-                if (pair.first.key != NULL) // skip null refs
-                    markObject((GObject*)pair.first.key);
+                if (node.key != NULL) // skip null refs
+                    markObject((GObject*)node.key);
             } else if constexpr (std::is_same<T, GValue>()) {
-                markValue(pair.first.key);
-            }
-            markValue(pair.second);
-        }
-    }
-
-    template <typename T>
-    void removeWhiteTable(GTable<T>* tbl) {
-        auto it = tbl->hashTable.begin();
-        while (it != tbl->hashTable.end()) {
-
-            // remove keys that are white
-            if (it->first.key != NULL && !it->first.key->isGray) {
-                it = tbl->hashTable.erase(it);
-            } else {
-                it++;
+                markValue(node.key);
             }
+            markValue(node.val);
         }
     }
 
@@ -2589,8 +4723,13 @@ namespace Gavel {
                 markObject((GObject*)boundCall->tbl);
                 break;
             }
+            case GOBJECT_ROPE: {
+                markObject((GObject*)reinterpret_cast<GObjectRope*>(obj)->flat);
+                break;
+            }
             case GOBJECT_TABLE: {
                 GObjectTable* tblObj = reinterpret_cast<GObjectTable*>(obj);
+                markArray(&tblObj->arr);
                 markTable<GValue>(&tblObj->val);
                 break;
             }
@@ -2608,21 +4747,221 @@ namespace Gavel {
         }
     }
 
+#ifndef GAVEL_NO_GCTHREADS
+    // steals half of someone's shared queue, returns true if we got anything
+    bool stealWork(GMarkWorker* self) {
+        for (std::unique_ptr<GMarkWorker>& worker : marker.workers) {
+            GMarkWorker* victim = worker.get();
+            if (victim->sharedSize.load(std::memory_order_relaxed) == 0)
+                continue;
+
+            std::lock_guard<std::mutex> guard(victim->lock);
+            size_t size = victim->shared.size();
+            if (size == 0)
+                continue;
+
+            size_t take = (size + 1) / 2;
+            self->stack.insert(self->stack.end(), victim->shared.end() - take, victim->shared.end());
+            victim->shared.resize(size - take);
+            victim->sharedSize.store(size - take, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // moves the bottom half of our stack (the oldest objects, so probably the biggest part of the graph) to our shared queue
+    void shareWork(GMarkWorker* self) {
+        size_t half = self->stack.size() / 2;
+
+        std::lock_guard<std::mutex> guard(self->lock);
+        self->shared.insert(self->shared.end(), self->stack.begin(), self->stack.begin() + half);
+        self->stack.erase(self->stack.begin(), self->stack.begin() + half);
+        self->sharedSize.store(self->shared.size(), std::memory_order_relaxed);
+    }
+
+    bool anyShared() {
+        for (std::unique_ptr<GMarkWorker>& worker : marker.workers) {
+            if (worker->sharedSize.load(std::memory_order_relaxed) > 0)
+                return true;
+        }
+        return false;
+    }
+
+    // ran by every thread marking, until everyone is out of work or we're past the deadline
+    void markLoop(GMarkWorker* self) {
+        int participants = (int)marker.workers.size();
+        int work = 0;
+        markWorker = self;
+
+        while (true) {
+            while (!self->stack.empty()) {
+                GObject* obj = self->stack.back();
+                self->stack.pop_back();
+                blackenObject(obj);
+
+                if ((++work & 31) == 0) {
+                    if (marker.hasDeadline && std::chrono::steady_clock::now() >= marker.deadline)
+                        marker.timeUp.store(true, std::memory_order_relaxed);
+                    if (marker.timeUp.load(std::memory_order_relaxed)) {
+                        markWorker = NULL;
+                        return;
+                    }
+
+                    // someone's starving, give them some of ours
+                    if (marker.idle.load(std::memory_order_relaxed) > 0 && self->stack.size() > 1)
+                        shareWork(self);
+                }
+            }
+
+            if (stealWork(self))
+                continue;
+
+            // nothing left that we can see, wait until someone shares or everyone is out of work
+            marker.idle.fetch_add(1);
+            while (true) {
+                if (marker.idle.load() == participants || marker.timeUp.load(std::memory_order_relaxed)) {
+                    markWorker = NULL;
+                    return;
+                }
+
+                if (anyShared()) {
+                    marker.idle.fetch_sub(1);
+                    if (stealWork(self))
+                        break;
+                    marker.idle.fetch_add(1);
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void helperThread(int id) {
+        unsigned lastJob = 0;
+        std::unique_lock<std::mutex> guard(marker.lock);
+
+        while (true) {
+            marker.wake.wait(guard, [&]() { return marker.quit || marker.jobId != lastJob; });
+            if (marker.quit)
+                return;
+
+            lastJob = marker.jobId;
+            GIsolate* job = marker.job;
+            guard.unlock();
+            {
+                GIsolateScope scope(job);
+                markLoop(marker.workers[id].get());
+            }
+            guard.lock();
+
+            if (--marker.running == 0)
+                marker.finished.notify_one();
+        }
+    }
+
+    // (re)starts the helpers so there's markThreads threads marking in total. marker.jobLock has to be held!
+    void startMarkThreads() {
+        {
+            std::lock_guard<std::mutex> guard(marker.lock);
+            marker.quit = true;
+        }
+        marker.wake.notify_all();
+        for (std::thread& t : marker.threads)
+            t.join();
+
+        marker.threads.clear();
+        marker.workers.clear();
+        marker.quit = false;
+        marker.jobId = 0;
+
+        for (int i = 0; i < markThreads; i++)
+            marker.workers.emplace_back(new GMarkWorker());
+        for (int i = 1; i < markThreads; i++)
+            marker.threads.emplace_back(helperThread, i);
+    }
+
+    // sets how many threads mark objects in a collection, including the one collecting. 1 turns the parallel marker off
+    void setMarkThreads(int threads) {
+        std::lock_guard<std::mutex> job(marker.jobLock);
+        markThreads = std::max(threads, 1);
+        startMarkThreads();
+    }
+
+    /* parallelMark(hasDeadline, deadline)
+        Blackens the grey objects with the helper threads, until there's nothing left (or we're past the deadline.) Returns false without doing anything if
+    another isolate is using the helpers.
+    */
+    bool parallelMark(bool hasDeadline, std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> job(marker.jobLock, std::try_to_lock);
+        if (!job.owns_lock())
+            return false;
+
+        if ((int)marker.workers.size() != markThreads)
+            startMarkThreads();
+
+        // hand out the grey objects, the helpers aren't running so we can touch their stacks
+        std::vector<GObject*>& grey = isolate->greyObjects;
+        for (size_t i = 0; i < grey.size(); i++)
+            marker.workers[i % marker.workers.size()]->stack.push_back(grey[i]);
+        grey.clear();
+
+        marker.idle.store(0);
+        marker.timeUp.store(false);
+        marker.hasDeadline = hasDeadline;
+        marker.deadline = deadline;
+
+        {
+            std::lock_guard<std::mutex> guard(marker.lock);
+            marker.job = isolate;
+            marker.running = (int)marker.threads.size();
+            marker.jobId++;
+        }
+        marker.wake.notify_all();
+
+        markLoop(marker.workers[0].get());
+
+        {
+            std::unique_lock<std::mutex> guard(marker.lock);
+            marker.finished.wait(guard, []() { return marker.running == 0; });
+        }
+
+        // if we hit the deadline, whatever's left is still grey
+        for (std::unique_ptr<GMarkWorker>& worker : marker.workers) {
+            grey.insert(grey.end(), worker->stack.begin(), worker->stack.end());
+            grey.insert(grey.end(), worker->shared.begin(), worker->shared.end());
+            worker->stack.clear();
+            worker->shared.clear();
+            worker->sharedSize.store(0, std::memory_order_relaxed);
+        }
+        return true;
+    }
+#endif
+
     void traceReferences() {
-        while (greyObjects.size() > 0) {
-            int currentIndex = greyObjects.size() - 1;
-            
-            // this probably adds more to the greyObjects vector
-            blackenObject(greyObjects[currentIndex]);
+        while (isolate->greyObjects.size() > 0) {
+#ifndef GAVEL_NO_GCTHREADS
+            if (markThreads > 1 && isolate->greyObjects.size() >= GC_PARALLELMIN && parallelMark(false, std::chrono::steady_clock::time_point::max()))
+                continue;
+#endif
+            GObject* obj = isolate->greyObjects.back();
+            isolate->greyObjects.pop_back();
 
-            // pop the right object!!!
-            greyObjects.erase(greyObjects.begin() + currentIndex);
+            // this probably adds more to the greyObjects vector
+            blackenObject(obj);
         }
-        greyObjects.clear();
+    }
+
+    // pushes an object that was already marked back onto the grey stack, so it gets traced again
+    void regrayObject(GObject* o) {
+        isolate->greyObjects.push_back(o);
+    }
+
+    // checks the clock every 32 units of work, returns true if we're past the deadline
+    inline bool pastDeadline(int work, std::chrono::steady_clock::time_point deadline) {
+        return isolate->maxPause != 0 && (work & 31) == 0 && std::chrono::steady_clock::now() >= deadline;
     }
 
     void markStates() {
-        GState* state = states;
+        GState* state = isolate->states;
 
         while (state != NULL) {
             state->markRoots();
@@ -2631,7 +4970,7 @@ namespace Gavel {
     }
 
     void markChunks() {
-        GChunk* chunk = chunks;
+        GChunk* chunk = isolate->chunks;
 
         while (chunk != NULL) {
             chunk->markRoots();
@@ -2639,53 +4978,480 @@ namespace Gavel {
         }
     }
 
-    void sweepUp() {
-        GObject* object = objList;
-        GObject* prev = NULL;
+    // frees an unmarked object (it should already be unlinked from it's list!)
+    void freeObject(GObject* object) {
+        DEBUGGC(std::cout << "freeing " << object->getSize() << " bytes [" << object->toStringDataType() << " : " << object->toString() << "]" << std::endl);
+        isolate->bytesAllocated = isolate->bytesAllocated - object->gcSize; // sub our size
+        isolate->stats.totalFreed += object->gcSize;
+        isolate->stats.objects[object->type]--;
+
+#ifdef GSTRING_INTERN
+        // a dead string can't be in the intern set anymore
+        if (object->type == GOBJECT_STRING)
+            isolate->strings.deleteKey(reinterpret_cast<GObjectString*>(object));
+#endif
+
+        delete object; // free's it using the virtual member's deconstructor. yay inheritance!
+    }
+
+    // sweeps the nursery, everything that survived is promoted to the old generation
+    void sweepYoung() {
+        GObject* object = isolate->youngList;
+
+        while (object != NULL) {
+            GObject* next = object->next;
+            if (object->isMarked()) {
+                object->setMarked(false);
+                object->isOld = true;
+                object->next = isolate->objList;
+                isolate->objList = object;
+            } else {
+                freeObject(object);
+            }
+            object = next;
+        }
+
+        isolate->youngList = NULL;
+        isolate->youngBytes = 0;
+    }
+
+    void rememberObject(GObject* o) {
+        o->isRemembered = true;
+        isolate->rememberedSet.push_back(o);
+    }
+
+    void clearRemembered() {
+        for (GObject* o : isolate->rememberedSet)
+            o->isRemembered = false;
+        isolate->rememberedSet.clear();
+    }
+
+    /* collectYoung()
+        Minor collection, only traces & sweeps the nursery. Old objects are assumed to be alive (the remembered set tells us which of them point to young objects), 
+    so this only costs as much as the roots + whatever was allocated since the last collection.
+    */
+    void collectYoung() {
+        DEBUGGC(std::cout << "\033[1;31m---====[[ MINOR COLLECTION, " << isolate->youngBytes << " BYTES IN THE NURSERY ]]====---\033[0m" << std::endl);
+
+        isolate->minorCollection = true;
+        markStates();
+        markChunks();
+        for (GObject* o : isolate->rememberedSet) {
+            o->isRemembered = false;
+            if (o->isOld)
+                blackenObject(o);
+            else
+                markObject(o);
+        }
+        isolate->rememberedSet.clear(); // after this there are no young objects left, so nothing old can point to one
+        traceReferences();
+        isolate->minorCollection = false;
+
+        sweepYoung();
+        isolate->stats.minorCollections++;
+    }
+
+    /* startCycle()
+        Starts a full (incremental) collection. The nursery is moved into the old generation so this collection handles everything, then the roots are marked. 
+    gcStep() does the rest.
+    */
+    void startCycle() {
+        DEBUGGC(std::cout << "\033[1;31m---====[[ COLLECTING GARBAGE, AT " << isolate->bytesAllocated << " BYTES... CPUNCH INCLUDED! ]]====---\033[0m" << std::endl);  
+
+        while (isolate->youngList != NULL) {
+            GObject* object = isolate->youngList;
+            isolate->youngList = object->next;
+            object->isOld = true;
+            object->next = isolate->objList;
+            isolate->objList = object;
+        }
+        isolate->youngBytes = 0;
+        clearRemembered(); // there's nothing young left
+
+        isolate->gcPhase = GC_MARK;
+        isolate->gcDebt = 0;
+        isolate->freedAtStart = isolate->stats.totalFreed;
+        markStates();
+        markChunks();
+    }
+
+#ifndef GAVEL_NO_GCTHREADS
+    // turns the background sweeper on/off for the current isolate. with it off, sweeping is done in slices like marking
+    void setBackgroundSweep(bool enabled) {
+        isolate->backgroundSweep = enabled;
+    }
+
+    /* backgroundSweep(iso)
+        Ran on the sweeper thread. Nothing in sweepList can be reached by the mutator unless it's marked, so the sweeper can unmark the survivors & destroy 
+    everything else while the mutator keeps running. It doesn't touch anything the mutator uses: survivors are kept in their own list, freed slots go in 
+    sweptSlots & the bytes are added up in sweptBytes. They're all handed back by finishBackgroundSweep().
+    */
+    void backgroundSweep(GIsolate* iso) {
+        GObject* survivors = NULL;
+        GObject* survivorsTail = NULL;
+        GObject* deferred = NULL;
+        size_t freed = 0;
+
+        GObject* object = iso->sweepList;
+        while (object != NULL) {
+            GObject* next = object->next;
+
+            if (object->isMarked()) {
+                object->setMarked(false); // unmark it to prepare for the next garbage collect
+                object->next = survivors;
+                survivors = object;
+                if (survivorsTail == NULL)
+                    survivorsTail = object;
+            } else if (object->type == GOBJECT_FUNCTION || object->type == GOBJECT_PROTOTABLE || object->type == GOBJECT_ROPE) {
+                // these touch other objects (or the isolate's chunks or bytesAllocated) when they're destroyed, so the mutator frees them
+                object->next = deferred;
+                deferred = object;
+            } else {
+                DEBUGGC(std::cout << "freeing " << object->gcSize << " bytes [" << object->toStringDataType() << " : " << object->toString() << "]" << std::endl);
+                freed += object->gcSize;
+                iso->sweptObjects[object->type]++;
+#ifndef GAVEL_NO_POOL
+                object->~GObject(); // destroy it, but give the slot back through sweptSlots
+                GPool::release(object, iso->sweptSlots);
+#else
+                delete object;
+#endif
+            }
+            object = next;
+        }
+
+        iso->sweptSurvivors = survivors;
+        iso->sweptSurvivorsTail = survivorsTail;
+        iso->sweptDeferred = deferred;
+        iso->sweptBytes = freed;
+        iso->sweepDone.store(true, std::memory_order_release);
+    }
+
+    void startBackgroundSweep() {
+        // dead strings have to leave the intern set now, since the mutator could find them there while they're being freed
+#ifdef GSTRING_INTERN
+        isolate->strings.removeIf([](GTable<GObjectString*>::Node& node) { return !node.key->isMarked(); });
+#endif
+        isolate->sweepDone.store(false, std::memory_order_relaxed);
+        isolate->sweeper = std::thread(backgroundSweep, isolate);
+    }
+
+    // waits for the sweeper & takes back everything it freed
+    void finishBackgroundSweep() {
+        isolate->sweeper.join();
+
+        if (isolate->sweptSurvivors != NULL) {
+            isolate->sweptSurvivorsTail->next = isolate->objList;
+            isolate->objList = isolate->sweptSurvivors;
+        }
+
+        while (isolate->sweptDeferred != NULL) {
+            GObject* object = isolate->sweptDeferred;
+            isolate->sweptDeferred = object->next;
+            freeObject(object);
+        }
+
+        isolate->bytesAllocated -= isolate->sweptBytes;
+        isolate->stats.totalFreed += isolate->sweptBytes;
+        for (int i = 0; i < GOBJECT_MAX; i++) {
+            isolate->stats.objects[i] -= isolate->sweptObjects[i];
+            isolate->sweptObjects[i] = 0;
+        }
+#ifndef GAVEL_NO_POOL
+        isolate->pool.adopt(isolate->sweptSlots);
+#endif
+        isolate->sweepList = NULL;
+        isolate->sweptSurvivors = NULL;
+        isolate->sweptSurvivorsTail = NULL;
+        isolate->sweptBytes = 0;
+    }
+#endif
+
+    // the mutator doesn't have write barriers on the stack, globals or chunks, so they're marked again now that every grey object is black. then we start sweeping
+    void finishMark() {
+        markStates();
+        markChunks();
+        traceReferences();
+
+        clearRemembered(); // could have old objects that are about to be freed
+        isolate->sweepList = isolate->objList;
+        isolate->objList = NULL;
+        isolate->gcPhase = GC_SWEEP;
+
+#ifndef GAVEL_NO_GCTHREADS
+        if (isolate->backgroundSweep)
+            startBackgroundSweep();
+#endif
+    }
+
+    void finishCycle() {
+        isolate->gcPhase = GC_IDLE;
+        DEBUGGC(std::cout << "New bytesAllocated: " << isolate->bytesAllocated << std::endl);
+
+        GGCStats& stats = isolate->stats;
+        stats.collections++;
+        stats.lastFreed = stats.totalFreed - isolate->freedAtStart;
+        stats.liveBytes = isolate->bytesAllocated;
+
+        // let the heap grow to [growth]% of what's alive before the next one
+        size_t live = isolate->bytesAllocated / 100;
+        size_t next = live != 0 && isolate->growth > SIZE_MAX / live ? SIZE_MAX : live * isolate->growth; // a huge growth just means never
+        isolate->nextGc = std::max(isolate->minThreshold, next);
+    }
+
+    // sweeps what's left in sweepList until the deadline, returns true if it's done. survivors are unmarked & moved back to objList
+    bool sweepSlice(std::chrono::steady_clock::time_point deadline) {
+#ifndef GAVEL_NO_GCTHREADS
+        // the sweeper's doing the work, we only wait for it if we're finishing the collection
+        if (isolate->sweeper.joinable()) {
+            if (deadline != std::chrono::steady_clock::time_point::max() && !isolate->sweepDone.load(std::memory_order_acquire))
+                return false;
+
+            finishBackgroundSweep();
+            return true;
+        }
+#endif
+
+        int work = 0;
+        while (isolate->sweepList != NULL) {
+            GObject* object = isolate->sweepList;
+            isolate->sweepList = object->next;
+
+            if (object->isMarked()) {
+                object->setMarked(false); // unmark it to prepare for the next garbage collect
+                object->next = isolate->objList;
+                isolate->objList = object;
+            } else {
+                freeObject(object);
+            }
+
+            if (pastDeadline(++work, deadline))
+                return isolate->sweepList == NULL;
+        }
+        return true;
+    }
+
+    // blackens grey objects until the deadline, returns true if there's none left
+    bool markSlice(std::chrono::steady_clock::time_point deadline) {
+        int work = 0;
+        while (isolate->greyObjects.size() > 0) {
+#ifndef GAVEL_NO_GCTHREADS
+            if (markThreads > 1 && isolate->greyObjects.size() >= GC_PARALLELMIN && parallelMark(isolate->maxPause != 0, deadline))
+                break;
+#endif
+            GObject* obj = isolate->greyObjects.back();
+            isolate->greyObjects.pop_back();
+            blackenObject(obj);
+
+            if (pastDeadline(++work, deadline))
+                break;
+        }
+        return isolate->greyObjects.size() == 0;
+    }
+
+    // does at most maxPause microseconds of work on the current full collection
+    void gcStep() {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(isolate->maxPause);
+        isolate->gcDebt = 0;
+
+        if (isolate->gcPhase == GC_MARK) {
+            if (!markSlice(deadline))
+                return;
+            finishMark();
+        }
+
+        if (isolate->gcPhase == GC_SWEEP && sweepSlice(deadline))
+            finishCycle();
+    }
+
+    // finishes the current full collection without stopping
+    void finishCollection() {
+        if (isolate->gcPhase == GC_MARK) {
+            traceReferences();
+            finishMark();
+        }
+
+        sweepSlice(std::chrono::steady_clock::time_point::max());
+        finishCycle();
+    }
+
+    // stop-the-world full collection. if one was already going, it's finished first (it's marks could be out of date)
+    void collectGarbage() { 
+        GPauseTimer pause;
+        if (isolate->gcPhase != GC_IDLE)
+            finishCollection();
+
+        startCycle();
+        finishCollection();
+    }
+
+    void addGarbage(GObject* g) { // for values generated dynamically, add it to our garbage to be marked & sweeped up!
+        // track memory
+        size_t size = g->getSize();
+        g->gcSize = size;
+        isolate->bytesAllocated += size;
+        isolate->stats.objects[g->type]++;
+        if (isolate->gcPhase != GC_IDLE)
+            isolate->gcDebt += size;
+
+        // new objects start in the nursery, unless we're marking (minor collections are paused until we're done)
+        if (isolate->gcPhase == GC_MARK) {
+            g->isOld = true;
+            g->next = isolate->objList;
+            isolate->objList = g;
+        } else {
+            isolate->youngBytes += size;
+            g->next = isolate->youngList;
+            isolate->youngList = g;
+        }
+    }
+
+    // an object the GC owns grew (or shrank), so the difference is counted like it was just allocated
+    void resizeObject(GObject* g, size_t newSize) {
+        isolate->bytesAllocated = isolate->bytesAllocated - g->gcSize + newSize;
+        if (newSize > g->gcSize) {
+            size_t grown = newSize - g->gcSize;
+            if (isolate->gcPhase != GC_IDLE)
+                isolate->gcDebt += grown;
+            if (!g->isOld)
+                isolate->youngBytes += grown;
+        }
+        g->gcSize = newSize;
+    }
+
+    /* resizeBuffer(counted, newSize)
+        For memory the GC counts that isn't an object of it's own, like a rope's buffer. counted is how much of it is in bytesAllocated right now, growing 
+    it is counted like an allocation & shrinking it (to 0 when it's freed) like a free.
+    */
+    void resizeBuffer(size_t& counted, size_t newSize) {
+        isolate->bytesAllocated = isolate->bytesAllocated - counted + newSize;
+        if (newSize > counted) {
+            size_t grown = newSize - counted;
+            if (isolate->gcPhase != GC_IDLE)
+                isolate->gcDebt += grown;
+            if (isolate->gcPhase != GC_MARK)
+                isolate->youngBytes += grown;
+        } else {
+            isolate->stats.totalFreed += counted - newSize;
+        }
+        counted = newSize;
+    }
+
+    // resident set size of the whole process in bytes, 0 if we can't tell on this platform
+    size_t getRSS() {
+#ifdef __linux__
+        FILE* f = fopen("/proc/self/statm", "r");
+        if (f == NULL)
+            return 0;
+
+        long pages = 0;
+        int read = fscanf(f, "%*s %ld", &pages);
+        fclose(f);
+        return read == 1 ? (size_t)pages * (size_t)sysconf(_SC_PAGESIZE) : 0;
+#else
+        return 0;
+#endif
+    }
+
+    GHeapStats getHeapStats() {
+        GHeapStats stats;
+        stats.objectBytes = isolate->bytesAllocated;
+        stats.youngBytes = isolate->youngBytes;
+        stats.nextGc = isolate->nextGc;
+#ifndef GAVEL_NO_POOL
+        stats.poolBytes = isolate->pool.pageBytes;
+        stats.poolUsedBytes = isolate->pool.usedBytes;
+        stats.largeBytes = isolate->pool.largeBytes;
+#endif
+
+        stats.internedStrings = isolate->strings.getSize();
+        stats.internBytes = isolate->strings.getMemory() + (isolate->greyObjects.capacity() + isolate->rememberedSet.capacity()) * sizeof(GObject*);
+        for (GChunk* chunk = isolate->chunks; chunk != NULL; chunk = chunk->next)
+            stats.chunkBytes += chunk->getSize();
+
+        stats.rss = getRSS();
+        return stats;
+    }
+
+    // a short label for the snapshot, so you can tell which table/string/function a node is
+    std::string getSnapshotName(GObject* o) {
+        std::string name;
+        switch (o->type) {
+            case GOBJECT_STRING: name = reinterpret_cast<GObjectString*>(o)->str(); break;
+            case GOBJECT_ROPE: name = reinterpret_cast<GObjectRope*>(o)->buf->substr(0, std::min(reinterpret_cast<GObjectRope*>(o)->len, (size_t)GSNAPSHOT_MAXNAME + 1)); break;
+            case GOBJECT_FUNCTION: name = reinterpret_cast<GObjectFunction*>(o)->getName(); break;
+            case GOBJECT_CLOSURE: name = reinterpret_cast<GObjectClosure*>(o)->val->getName(); break;
+            case GOBJECT_TABLE: name = std::to_string(reinterpret_cast<GObjectTable*>(o)->getLength()) + " entries"; break;
+            default: break;
+        }
+
+        if (name.length() > GSNAPSHOT_MAXNAME)
+            name = name.substr(0, GSNAPSHOT_MAXNAME) + "...";
+        return name;
+    }
+
+    /* writeHeapSnapshot(out)
+        Writes every object reachable from the current isolate's roots, & what references what, to out. Node 0 is '(roots)', it points to a node for each
+    state & one for the chunks, those point to the objects they keep alive. The format (numbers are in this machine's byte order):
+        - "GHEAP" & a version byte (GSNAPSHOT_VERSION)
+        - uint32 node count, then for each node: uint8 GObjType (GOBJECT_NULL for the roots), uint64 size (the same bytes the GC counts), uint32 name length & the name
+        - uint32 edge count, then for each edge: uint32 from, uint32 to
+    Run 'Gavel --heap <file>' to see what's retaining what.
+    */
+    void writeHeapSnapshot(std::ostream& out) {
+        // let any collection that's running finish, so the sizes are settled & nothing half-swept is left around
+        if (isolate->gcPhase != GC_IDLE)
+            finishCollection();
+
+        GHeapWalker walker;
+        heapWalker = &walker;
+
+        uint32_t root = walker.addRoot("(roots)");
+        int stateNum = 0;
+        for (GState* state = isolate->states; state != NULL; state = state->next) {
+            uint32_t stateRoot = walker.addRoot("(state " + std::to_string(++stateNum) + ")");
+            walker.edges.push_back({root, stateRoot});
+            walker.from = stateRoot;
+            state->markRoots();
+        }
 
-        // traverse the linked list of GObjects, removing all WHITE objects (not grey-marked objects)
-        while (object != NULL) {
-            if (object->isGray) {
-                object->isGray = false; // unmark it to prepare for the next garbage collect
-                prev = object;
-                object = object->next; // goes to next linked object
-            } else {
-                DEBUGGC(std::cout << "freeing " << object->getSize() << " bytes [" << object->toStringDataType() << " : " << object->toString() << "]" << std::endl);
-                // free memory and remove it from the linked list!!
-                GObject* garb = object;
-                bytesAllocated = bytesAllocated - object->getSize(); // sub our size
-
-                object = object->next;
-                if (prev != NULL) {
-                    prev->next = object;
-                } else {
-                    objList = object;
-                }
+        uint32_t chunkRoot = walker.addRoot("(chunks)");
+        walker.edges.push_back({root, chunkRoot});
+        walker.from = chunkRoot;
+        markChunks();
 
-                delete garb; // free's it using the virtual member's deconstructor. yay inheritance!
-            }
+        // objects is appended to while we walk it, so everything reachable gets walked once
+        for (uint32_t i = 0; i < walker.objects.size(); i++) {
+            if (walker.objects[i] == NULL)
+                continue;
+
+            walker.from = i;
+            blackenObject(walker.objects[i]);
         }
-    }
+        heapWalker = NULL;
 
-    void collectGarbage() { 
-        DEBUGGC(std::cout << "\033[1;31m---====[[ COLLECTING GARBAGE, AT " << bytesAllocated << " BYTES... CPUNCH INCLUDED! ]]====---\033[0m" << std::endl);  
+        auto write = [&out](auto x) {
+            out.write(reinterpret_cast<const char*>(&x), sizeof(x));
+        };
 
-        markStates();
-        markChunks();
-        traceReferences();
-        removeWhiteTable<GObjectString*>(&strings);
-        sweepUp();
-    }
+        out.write(GSNAPSHOT_MAGIC, strlen(GSNAPSHOT_MAGIC));
+        write((uint8_t)GSNAPSHOT_VERSION);
 
-    void addGarbage(GObject* g) { // for values generated dynamically, add it to our garbage to be marked & sweeped up!
-        // track memory
-        bytesAllocated += g->getSize();
+        write((uint32_t)walker.objects.size());
+        for (uint32_t i = 0; i < walker.objects.size(); i++) {
+            GObject* o = walker.objects[i];
+            std::string name = o != NULL ? getSnapshotName(o) : walker.rootNames[i];
+            write((uint8_t)(o != NULL ? o->type : GOBJECT_NULL));
+            write((uint64_t)(o != NULL ? o->gcSize : 0));
+            write((uint32_t)name.length());
+            out.write(name.c_str(), name.length());
+        }
 
-        if (objList != NULL) {
-            // append g to the objList
-            g->next = objList;
+        write((uint32_t)walker.edges.size());
+        for (auto& edge : walker.edges) {
+            write(edge.first);
+            write(edge.second);
         }
-        objList = g;
     }
 #endif
 
@@ -2704,9 +5470,9 @@ namespace Gavel {
         else if constexpr (std::is_same<T, char*>() || std::is_same<T, const char*>() || std::is_same<T, std::string>()) {
             GObjectString* obj = addString(x);
             return GValue((GObject*)obj);
-        } else if constexpr (std::is_same<T, GAVELCFUNC>()) {
+        } else if constexpr (std::is_same<T, GAVELCFUNC>() || std::is_same<T, GAVELSPANFUNC>()) {
             GValue temp = CREATECONST_CFUNCTION(x);
-            addGarbage((GObject*)temp.val.obj);
+            addGarbage((GObject*)READGVALUEOBJ(temp));
             return temp;
         } else if constexpr ( std::is_same<T, GObjectFunction*>()) {
             addGarbage((GObject*)x);
@@ -2937,6 +5703,14 @@ private:
     int pushedVals = 0;
     int pushedOffset = 0; // when entering a new expression, this is the ammount of pushed values we started with
 
+    // tracks the last 2 simple loads (a local or a constant) so binaryOp can fold them into a register instruction. [0] is the newest
+    struct FoldableLoad {
+        int index;
+        int rk;
+    } lastLoads[2] = {{-1, 0}, {-1, 0}};
+    int lastRKOp = -1; // index of the last register instruction that pushed its result
+    int lastAssign = -1; // index of a OP_SETBASE that directly stores lastRKOp's result
+
     struct Token {
         GTokenType type;
         std::string str;
@@ -3441,7 +6215,24 @@ private:
     */
     int emitPUSHCONST(GValue c) {
         pushedVals++;
-        return emitInstruction(CREATE_iAx(OP_LOADCONST, getChunk()->addConstant(c)));
+        int k = getChunk()->addConstant(c);
+        int i = emitInstruction(CREATE_iAx(OP_LOADCONST, k));
+        if (k <= MAXINDEXRK)
+            markFoldableLoad(i, RKASK(k));
+        return i;
+    }
+
+    // remembers a simple load at instruction i so it can be used as an RK operand
+    void markFoldableLoad(int i, int rk) {
+        lastLoads[1] = lastLoads[0];
+        lastLoads[0] = {i, rk};
+    }
+
+    // called whenever previously emitted instructions are moved or patched, since jumps might now land in between them
+    void resetFolding() {
+        lastLoads[0].index = lastLoads[1].index = -1;
+        lastRKOp = -1;
+        lastAssign = -1;
     }
 
     /* emitJumpBack(int instructionIndex)
@@ -3457,11 +6248,13 @@ private:
 
     void removePlaceholder(int i) {
         getChunk()->removeInstruction(i);
+        resetFolding();
     }
 
     // patches a placehoder with an instruction
     void patchPlaceholder(int i, INSTRUCTION inst) {
         getChunk()->patchInstruction(i, inst);
+        resetFolding();
     }
 
     bool consumeToken(GTokenType expectedType, std::string errStr) {
@@ -3500,7 +6293,10 @@ private:
         
         if (canAssign && matchToken(TOKEN_EQUAL)) {            
             expression();  
-            emitInstruction(CREATE_iAx(setOp, indx));
+            int i = emitInstruction(CREATE_iAx(setOp, indx));
+            // if we're just storing the result of a register instruction, balanceStack can have it write to the local directly
+            if (setOp == OP_SETBASE && indx <= MAXINDEXRK && lastRKOp == i - 1)
+                lastAssign = i;
         } else if (canAssign && matchToken(TOKEN_PLUS_PLUS)) {
             emitInstruction(CREATE_iAx(getOp, indx));
             emitInstruction(CREATE_iAx(OP_INC, 1)); // it'll leave the pre inc value on the stack
@@ -3514,7 +6310,9 @@ private:
             emitInstruction(CREATE_iAx(setOp, indx));
             emitInstruction(CREATE_iAx(OP_POP, 1)); // pop the value we just assigned
         }else {            
-            emitInstruction(CREATE_iAx(getOp, indx));
+            int i = emitInstruction(CREATE_iAx(getOp, indx));
+            if (getOp == OP_GETBASE && indx <= MAXINDEXRK)
+                markFoldableLoad(i, indx);
             pushedVals++;
         }
     }
@@ -3906,6 +6704,7 @@ private:
             
             pushedVals--; // OP_FOREACH will pop it :)
             emitInstruction(CREATE_i(OP_FOREACH));
+            endScope(); // closes the scope we opened above
             return;
         } else if (matchToken(TOKEN_EOS)) {
             // no intializer
@@ -4115,6 +6914,17 @@ private:
 
     // called at the end of a statement, returns new value of pushedVals
     int balanceStack(int offset) {
+        GChunk* chunk = getChunk();
+        // 'x = a + b' statement? have the register instruction write straight to x instead of pushing, assigning & popping it
+        if ((pushedVals-offset) > 0 && lastAssign != -1 && lastAssign == chunk->code.size() - 1) {
+            INSTRUCTION rkInst = chunk->code[lastRKOp];
+            int slot = GETARG_Ax(chunk->code[lastAssign]);
+            chunk->removeInstruction(lastAssign);
+            chunk->patchInstruction(lastRKOp, CREATE_iABC(GET_OPCODE(rkInst), slot, GETARG_B(rkInst), GETARG_C(rkInst)));
+            pushedVals--;
+            resetFolding();
+        }
+
         if ((pushedVals-offset) < 0) {
             throwObjection("Expression expected! [" + std::to_string((pushedVals - offset)) + "]");
         } else if ((pushedVals-offset) > 0) {
@@ -4225,6 +7035,39 @@ private:
         parsePrecedence((Precedence)(rule.precedence + 1));    
         DEBUGLOG(std::cout << "end Binary operator token! " << std::endl);
 
+        // both operands are plain locals or constants? use the register instructions instead of pushing them
+        GChunk* chunk = getChunk();
+        int top = chunk->code.size();
+        if (lastLoads[0].index == top - 1 && lastLoads[1].index == top - 2) {
+            int b = lastLoads[1].rk, c = lastLoads[0].rk;
+            int op = -1;
+            switch (token.type) {
+                case TOKEN_EQUAL_EQUAL: case TOKEN_BANG_EQUAL:      op = OP_EQUALRK; break;
+                case TOKEN_LESS: case TOKEN_GREATER_EQUAL:          op = OP_LESSRK; break;
+                case TOKEN_GREATER: case TOKEN_LESS_EQUAL:          op = OP_GREATERRK; break;
+                case TOKEN_PLUS:                                    op = OP_ADDRK; break;
+                case TOKEN_MINUS:                                   op = OP_SUBRK; break;
+                case TOKEN_STAR:                                    op = OP_MULRK; break;
+                case TOKEN_SLASH:                                   op = OP_DIVRK; break;
+                case TOKEN_PERCENT:                                 op = OP_MODRK; break;
+                default: break;
+            }
+
+            if (op != -1) {
+                chunk->removeInstruction(top - 1);
+                chunk->removeInstruction(top - 2);
+                resetFolding();
+                lastRKOp = emitInstruction(CREATE_iABC(op, 0, b, c));
+
+                // these don't have their own instructions, just flip the result
+                if (token.type == TOKEN_BANG_EQUAL || token.type == TOKEN_LESS_EQUAL || token.type == TOKEN_GREATER_EQUAL)
+                    emitInstruction(CREATE_i(OP_NOT));
+
+                pushedVals--;
+                return;
+            }
+        }
+
         // Emit the operator instruction.                        
         switch (token.type) {   
             case TOKEN_EQUAL_EQUAL:     emitInstruction(CREATE_i(OP_EQUAL)); break; 
@@ -4274,6 +7117,11 @@ public:
             // free function for them
             delete getFunction();
         }
+#ifndef GAVEL_NO_PEEPHOLE
+        else {
+            getChunk()->optimize();
+        }
+#endif
 
         // returns true if we're *not* in a paniced state
         return !panic;
@@ -4303,21 +7151,32 @@ namespace GavelLib {
     // all of these shouldn't even be public-facing anyways! so there's no need to include it when not INITing
 #ifdef _GAVEL_INIT 
 
-    GValue _print(GState* state, std::vector<GValue> &args) {
+    GValue _print(GState* state, GArgs args) {
         // prints all the passed arguments
+        GOutput& out = state->output;
         for (GValue val : args) {
-            printf("%s", val.toString().c_str());
+            // numbers & strings are written straight into the output buffer, without making a std::string first
+            if (ISGVALUENUMBER(val)) {
+                char buf[GNUMBER_MAXCHARS];
+                out.write(buf, formatNumber(READGVALUENUMBER(val), buf));
+            } else if (ISGVALUESTRING(val)) {
+                out.write(READGVALUESTRING(val));
+            } else {
+                out.write(val.toString());
+            }
         }
 
-        printf("\n");
+        out.write('\n');
+        out.checkFlush();
         return CREATECONST_NIL(); // no return value (technically there is [NIL], but w/e)
     }
     
-    GValue _input(GState* state, std::vector<GValue> &args) {
+    GValue _input(GState* state, GArgs args) {
         // prints all the passed arguments
         for (GValue val : args) {
-            std::cout << val.toString();
+            state->output.write(val.toString());
         }
+        state->output.flush(); // so the prompt shows up before we wait
 
         std::string i;
         std::getline(std::cin, i);
@@ -4325,7 +7184,7 @@ namespace GavelLib {
         return Gavel::newGValue(i); // newGValue is the recommended way to create values. it'll handle stuff like adding to the gc, and has automatic bindings for c++ primitives to gvalues!
     }
 
-    GValue _compileString(GState* state, std::vector<GValue> &args) {
+    GValue _compileString(GState* state, GArgs args) {
 #ifndef EXCLUDE_COMPILER
         // verifies args
         if (args.size() != 1) {
@@ -4340,9 +7199,11 @@ namespace GavelLib {
         }
 
         // compiles GObjectFunction from string
-        GavelParser compiler(READGVALUESTRING(arg).c_str());
+        GavelParser compiler(READGVALUESTRING(arg).data()); // strings are always '\0' terminated
         if (!compiler.compile()) { // compiler objection was thrown, return nil
-            std::cout << compiler.getObjection().getFormatedString() << std::endl;
+            // through the state's output, so it stays in order with what the script already printed
+            state->output.write(compiler.getObjection().getFormatedString());
+            state->output.write('\n');
             return CREATECONST_NIL();
         }
 
@@ -4354,7 +7215,7 @@ namespace GavelLib {
 #endif
     }
 
-    GValue _tonumber(GState* state, std::vector<GValue> &args) {
+    GValue _tonumber(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4366,10 +7227,10 @@ namespace GavelLib {
             return CREATECONST_NIL();
         }
 
-        return Gavel::newGValue((atof(READGVALUESTRING(arg).c_str())));
+        return Gavel::newGValue((atof(READGVALUESTRING(arg).data())));
     }
 
-    GValue _type(GState* state, std::vector<GValue> &args) {
+    GValue _type(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4378,20 +7239,24 @@ namespace GavelLib {
         return Gavel::newGValue(args[0].toStringDataType());
     }
 
-    GValue _tostring(GState* state, std::vector<GValue> &args) {
+    GValue _tostring(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
         }
 
         GValue arg = state->stack.getTop(0);
+        if (ISGVALUENUMBER(arg)) {
+            char buf[GNUMBER_MAXCHARS];
+            return GValue((GObject*)Gavel::addString(std::string_view(buf, formatNumber(READGVALUENUMBER(arg), buf))));
+        }
         return Gavel::newGValue(arg.toString());
     }
 
     // ======================= [[ MATH ]] =======================
 
     // library implementation for math.sin
-    GValue _sin(GState* state, std::vector<GValue> &args) {
+    GValue _sin(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4408,7 +7273,7 @@ namespace GavelLib {
     }
 
     // library implementation for math.cos
-    GValue _cos(GState* state, std::vector<GValue> &args) {
+    GValue _cos(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4425,7 +7290,7 @@ namespace GavelLib {
     }
 
     // library implementation for math.tan
-    GValue _tan(GState* state, std::vector<GValue> &args) {
+    GValue _tan(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4441,7 +7306,7 @@ namespace GavelLib {
         return Gavel::newGValue(tan(READGVALUENUMBER(arg)));
     }
 
-    GValue _random(GState* state, std::vector<GValue> &args) {
+    GValue _random(GState* state, GArgs args) {
         if (args.size() < 1) { // random number
             return CREATECONST_NUMBER(rand());
         } else if (args.size() == 1) { // 0 - arg
@@ -4500,29 +7365,155 @@ namespace GavelLib {
 
     // ======================= [[ STRING ]] =======================
 
-    GValue _substring(GState* state, std::vector<GValue>& args) {
+    // views the string in args[i], throws an objection & returns false if it isn't a string
+    bool _stringArg(GState* state, GArgs& args, int i, std::string_view& out) {
+        if (i >= args.size() || !ISGVALUESTRING(args[i])) {
+            state->throwObjection("Expected type [STRING] for argument #" + std::to_string(i + 1) + ". " + (i < args.size() ? args[i].toStringDataType() : "[NIL]") + " given");
+            return false;
+        }
+
+        out = READGVALUESTRING(args[i]);
+        return true;
+    }
+
+    bool _numberArg(GState* state, GArgs& args, int i, double& out) {
+        if (i >= args.size() || !ISGVALUENUMBER(args[i])) {
+            state->throwObjection("Expected type [NUMBER] for argument #" + std::to_string(i + 1) + ". " + (i < args.size() ? args[i].toStringDataType() : "[NIL]") + " given");
+            return false;
+        }
+
+        out = READGVALUENUMBER(args[i]);
+        return true;
+    }
+
+    // the string functions build their results in here & hand it to addString(), so the only allocation is the GObjectString itself
+    std::string& _stringBuffer(size_t size) {
+        static thread_local std::string buf;
+        if (buf.capacity() > 1024 * 64 && size <= 1024 * 64)
+            buf = std::string(); // don't hold onto a huge buffer forever
+
+        buf.clear();
+        buf.reserve(size);
+        return buf;
+    }
+
+    // false (& a "memory limit exceeded" objection) if a result this big won't fit
+    bool _reserveString(GState* state, double size) {
+        if (!(size <= (double)UINT32_MAX)) { // also catches NaN
+            state->throwObjection("Resulting string is too large!");
+            return false;
+        }
+
+        if (!Gavel::reserveMemory((size_t)size)) {
+            state->throwObjection("memory limit exceeded");
+            return false;
+        }
+
+        return true;
+    }
+
+    // how long v is as a string, & appending it. strings, ropes & numbers don't go through toString()
+    size_t _valueLength(GValue v) {
+        if (ISGVALUESTRING(v))
+            return READGVALUESTRING(v).size();
+        if (ISGVALUEROPE(v))
+            return reinterpret_cast<GObjectRope*>(READGVALUEOBJ(v))->len;
+        if (ISGVALUENUMBER(v)) {
+            char buf[GNUMBER_MAXCHARS];
+            return formatNumber(READGVALUENUMBER(v), buf);
+        }
+        if (ISGVALUECHARACTER(v))
+            return 1;
+        return v.toString().size();
+    }
+
+    void _appendValue(std::string& out, GValue v) {
+        if (ISGVALUESTRING(v)) {
+            out += READGVALUESTRING(v);
+        } else if (ISGVALUEROPE(v)) {
+            GObjectRope* rope = reinterpret_cast<GObjectRope*>(READGVALUEOBJ(v));
+            out.append(*rope->buf, 0, rope->len);
+        } else if (ISGVALUENUMBER(v)) {
+            char buf[GNUMBER_MAXCHARS];
+            out.append(buf, formatNumber(READGVALUENUMBER(v), buf));
+        } else if (ISGVALUECHARACTER(v)) {
+            out += READGVALUECHARACTER(v);
+        } else {
+            out += v.toString();
+        }
+    }
+
+    // appends v formatted with the printf spec, false (& an objection) if it's too big
+    template <typename T>
+    bool _appendFormat(GState* state, std::string& out, const std::string& spec, T v) {
+        int len = snprintf(NULL, 0, spec.c_str(), v);
+        if (len <= 0)
+            return true;
+
+        if (!_reserveString(state, (double)out.size() + len))
+            return false;
+
+        size_t at = out.size();
+        out.resize(at + len + 1);
+        snprintf(&out[at], len + 1, spec.c_str(), v);
+        out.resize(at + len);
+        return true;
+    }
+
+    // the integer conversions in string.format need a number that fits in a long long, casting anything else (NaN, inf, 1e50) is undefined
+    bool _formatInteger(GState* state, GValue v, char conv, long long& out) {
+        if (!ISGVALUENUMBER(v)) {
+            state->throwObjection(std::string("Expected type [NUMBER] for '%") + conv + "', " + v.toStringDataType() + " given");
+            return false;
+        }
+
+        double n = READGVALUENUMBER(v);
+        if (!(n >= -9223372036854775808.0 && n < 9223372036854775808.0)) {
+            state->throwObjection(std::string("Number for '%") + conv + "' has no integer representation!");
+            return false;
+        }
+
+        out = (long long)n;
+        return true;
+    }
+
+    GValue _substring(GState* state, GArgs args) {
         if (args.size() == 2) {
             // grabing args[1] characters from args[0]
             GValue str = args[0]; // can be any value, we'll just use str.toString() for compatibity with many datatypes
             GValue indx = args[1];
-            std::string temp = str.toString();
+            std::string temp;
+            std::string_view view;
+            if (ISGVALUESTRING(str)) {
+                view = READGVALUESTRING(str);
+            } else {
+                temp = str.toString();
+                view = temp;
+            }
 
             if (!ISGVALUENUMBER(indx)) {
                 state->throwObjection("Expected type [NUMBER] for 2nd argument. " + indx.toStringDataType() + " given");
                 return CREATECONST_NIL();
             }
 
-            if ((int)READGVALUENUMBER(indx) >= temp.length() || (int)READGVALUENUMBER(indx) < 0) {
+            if ((int)READGVALUENUMBER(indx) >= (int)view.length() || (int)READGVALUENUMBER(indx) < 0) {
                 state->throwObjection("Index is out of bounds!");
                 return CREATECONST_NIL();
             }
 
-            return Gavel::newGValue(temp.substr((int)READGVALUENUMBER(indx)));
+            return CREATECONST_STRING(view.substr((int)READGVALUENUMBER(indx)));
         } else if (args.size() == 3) {
             GValue str = args[0];
             GValue startIndx = args[1];
             GValue endIndx = args[2];
-            std::string temp = str.toString();
+            std::string temp;
+            std::string_view view;
+            if (ISGVALUESTRING(str)) {
+                view = READGVALUESTRING(str);
+            } else {
+                temp = str.toString();
+                view = temp;
+            }
 
             // sanity checks
             if (!ISGVALUENUMBER(startIndx)) {
@@ -4535,12 +7526,12 @@ namespace GavelLib {
                 return CREATECONST_NIL();
             }
 
-            if ((int)READGVALUENUMBER(startIndx) >= temp.length() || (int)READGVALUENUMBER(startIndx) < 0) {
+            if ((int)READGVALUENUMBER(startIndx) >= (int)view.length() || (int)READGVALUENUMBER(startIndx) < 0) {
                 state->throwObjection("Start index is out of bounds!");
                 return CREATECONST_NIL();
             }
 
-            if ((int)READGVALUENUMBER(endIndx) >= temp.length() || (int)READGVALUENUMBER(endIndx) < 0) {
+            if ((int)READGVALUENUMBER(endIndx) >= (int)view.length() || (int)READGVALUENUMBER(endIndx) < 0) {
                 state->throwObjection("End index is out of bounds!");
                 return CREATECONST_NIL();
             }
@@ -4550,14 +7541,14 @@ namespace GavelLib {
                 return CREATECONST_NIL();
             }
 
-            return Gavel::newGValue(temp.substr((int)READGVALUENUMBER(startIndx), (int)READGVALUENUMBER(endIndx)));
+            return CREATECONST_STRING(view.substr((int)READGVALUENUMBER(startIndx), (int)READGVALUENUMBER(endIndx)));
         } else {
             state->throwObjection("Expected 2-3 arguments, " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
         }
     }
 
-    GValue _lowerstring(GState* state, std::vector<GValue>& args) {
+    GValue _lowerstring(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument! " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4568,22 +7559,20 @@ namespace GavelLib {
             return CREATECONST_NIL();
         }
 
-        std::string newString;
+        std::string_view str = READGVALUESTRING(args[0]);
+        std::string& newString = _stringBuffer(str.size());
 
         // allocate space
-        newString.resize(READGVALUESTRING(args[0]).size());
+        newString.resize(str.size());
 
         // convert args[0] string to lower and put result to newString
-        std::transform(READGVALUESTRING(args[0]).begin(),
-            READGVALUESTRING(args[0]).end(),
-            newString.begin(),
-            ::tolower);
+        std::transform(str.begin(), str.end(), newString.begin(), ::tolower);
         
         // return string result
-        return Gavel::newGValue(newString);
+        return CREATECONST_STRING(newString);
     }
 
-    GValue _upperstring(GState* state, std::vector<GValue>& args) {
+    GValue _upperstring(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument! " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4594,22 +7583,20 @@ namespace GavelLib {
             return CREATECONST_NIL();
         }
 
-        std::string newString;
+        std::string_view str = READGVALUESTRING(args[0]);
+        std::string& newString = _stringBuffer(str.size());
 
         // allocate space
-        newString.resize(READGVALUESTRING(args[0]).size());
+        newString.resize(str.size());
 
         // convert args[0] string to upper and put result to newString
-        std::transform(READGVALUESTRING(args[0]).begin(),
-            READGVALUESTRING(args[0]).end(),
-            newString.begin(),
-            ::toupper);
+        std::transform(str.begin(), str.end(), newString.begin(), ::toupper);
         
         // return string result
-        return Gavel::newGValue(newString);
+        return CREATECONST_STRING(newString);
     }
 
-    GValue _findstring(GState* state, std::vector<GValue>& args) {
+    GValue _findstring(GState* state, GArgs args) {
         int startIndx = 0;
 
         if (args.size() != 2 && args.size() != 3) {
@@ -4650,11 +7637,303 @@ namespace GavelLib {
             return CREATECONST_NIL();
     }
 
-    // TODO: string.replace(); string.setChar()
+    // string.split(str, sep) returns a table of the pieces between each sep (starting at index 0), an empty sep splits it into single characters
+    GValue _splitstring(GState* state, GArgs args) {
+        std::string_view str, sep;
+        if (args.size() != 2) {
+            state->throwObjection("Expected 2 arguments, " + std::to_string(args.size()) + " given");
+            return CREATECONST_NIL();
+        }
+
+        if (!_stringArg(state, args, 0, str) || !_stringArg(state, args, 1, sep))
+            return CREATECONST_NIL();
+
+        // count the pieces first so the array part is only allocated once
+        size_t pieces = str.size();
+        if (!sep.empty()) {
+            pieces = 1;
+            for (size_t pos = str.find(sep); pos != std::string_view::npos; pos = str.find(sep, pos + sep.size()))
+                pieces++;
+        }
+
+        GObjectTable* tbl = new GObjectTable();
+        tbl->arr.reserve(pieces);
+
+        if (sep.empty()) {
+            for (size_t i = 0; i < str.size(); i++)
+                tbl->setIndex(CREATECONST_NUMBER(i), CREATECONST_STRING(str.substr(i, 1)));
+        } else {
+            size_t start = 0;
+            for (size_t i = 0; i < pieces; i++) {
+                size_t end = std::min(str.find(sep, start), str.size());
+                tbl->setIndex(CREATECONST_NUMBER(i), CREATECONST_STRING(str.substr(start, end - start)));
+                start = end + sep.size();
+            }
+        }
+
+        return Gavel::newGValue(tbl);
+    }
+
+    // string.join(tbl, sep) concatenates tbl[0] to tbl[#tbl-1] with sep in between. sep is optional
+    GValue _joinstring(GState* state, GArgs args) {
+        std::string_view sep;
+        if (args.size() != 1 && args.size() != 2) {
+            state->throwObjection("Expected 1 or 2 arguments, " + std::to_string(args.size()) + " given");
+            return CREATECONST_NIL();
+        }
+
+        if (!ISGVALUETABLE(args[0])) {
+            state->throwObjection("Expected type [TABLE] for argument #1. " + args[0].toStringDataType() + " given");
+            return CREATECONST_NIL();
+        }
+
+        if (args.size() == 2 && !_stringArg(state, args, 1, sep))
+            return CREATECONST_NIL();
+
+        GObjectTable* tbl = reinterpret_cast<GObjectTable*>(READGVALUEOBJ(args[0]));
+        int len = tbl->getLength();
+
+        double size = 0;
+        for (int i = 0; i < len; i++)
+            size += _valueLength(tbl->getIndex(CREATECONST_NUMBER(i))) + (i > 0 ? sep.size() : 0);
+
+        if (!_reserveString(state, size))
+            return CREATECONST_NIL();
+
+        std::string& out = _stringBuffer((size_t)size);
+        for (int i = 0; i < len; i++) {
+            if (i > 0)
+                out += sep;
+            _appendValue(out, tbl->getIndex(CREATECONST_NUMBER(i)));
+        }
+
+        return CREATECONST_STRING(out);
+    }
+
+    /* string.format(fmt, ...)
+        printf style formatting. %s takes any value, %d %i %x %X %o take numbers (as integers), %f %F %e %E %g %G take numbers & %c takes a character or a 
+    number. flags, width & precision work like printf, %% is a '%'.
+    */
+    GValue _formatstring(GState* state, GArgs args) {
+        std::string_view fmt;
+        if (!_stringArg(state, args, 0, fmt))
+            return CREATECONST_NIL();
+
+        std::string& out = _stringBuffer(fmt.size() + args.size() * 8);
+        int arg = 1;
+        for (size_t i = 0; i < fmt.size(); i++) {
+            if (fmt[i] != '%') {
+                // copy everything up to the next '%' at once
+                size_t next = std::min(fmt.find('%', i), fmt.size());
+                out += fmt.substr(i, next - i);
+                i = next - 1;
+                continue;
+            }
+
+            if (i + 1 < fmt.size() && fmt[i + 1] == '%') {
+                out += '%';
+                i++;
+                continue;
+            }
+
+            // grab the flags, width & precision
+            size_t start = i++;
+            while (i < fmt.size() && strchr("-+ #0", fmt[i]))
+                i++;
+            while (i < fmt.size() && isdigit(fmt[i]))
+                i++;
+            if (i < fmt.size() && fmt[i] == '.') {
+                i++;
+                while (i < fmt.size() && isdigit(fmt[i]))
+                    i++;
+            }
+
+            if (i >= fmt.size()) {
+                state->throwObjection("Incomplete format specifier!");
+                return CREATECONST_NIL();
+            }
+
+            char conv = fmt[i];
+            std::string spec(fmt.substr(start, i - start));
+            if (arg >= args.size()) {
+                state->throwObjection("Missing argument #" + std::to_string(arg + 1) + " for '%" + conv + "'");
+                return CREATECONST_NIL();
+            }
+            GValue v = args[arg++];
+
+            bool ok = true;
+            switch (conv) {
+                case 'd': case 'i': case 'x': case 'X': case 'o': {
+                    long long n;
+                    if (!_formatInteger(state, v, conv, n))
+                        return CREATECONST_NIL();
+                    spec += "ll";
+                    spec += conv;
+                    ok = _appendFormat(state, out, spec, n);
+                    break;
+                }
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+                    if (!ISGVALUENUMBER(v)) {
+                        state->throwObjection(std::string("Expected type [NUMBER] for '%") + conv + "', " + v.toStringDataType() + " given");
+                        return CREATECONST_NIL();
+                    }
+                    spec += conv;
+                    ok = _appendFormat(state, out, spec, READGVALUENUMBER(v));
+                    break;
+                }
+                case 'c': {
+                    long long c = 0;
+                    if (ISGVALUECHARACTER(v)) {
+                        c = (unsigned char)READGVALUECHARACTER(v);
+                    } else if (!ISGVALUENUMBER(v)) {
+                        state->throwObjection("Expected type [CHAR] for '%c', " + v.toStringDataType() + " given");
+                        return CREATECONST_NIL();
+                    } else if (!_formatInteger(state, v, conv, c)) {
+                        return CREATECONST_NIL();
+                    }
+                    spec += conv;
+                    ok = _appendFormat(state, out, spec, (int)(unsigned char)c);
+                    break;
+                }
+                case 's': {
+                    // the common case, no width or precision
+                    if (spec.size() == 1) {
+                        _appendValue(out, v);
+                        break;
+                    }
+
+                    spec += conv;
+                    ok = _appendFormat(state, out, spec, v.toString().c_str());
+                    break;
+                }
+                default:
+                    state->throwObjection(std::string("Invalid format specifier '%") + conv + "'");
+                    return CREATECONST_NIL();
+            }
+
+            if (!ok)
+                return CREATECONST_NIL();
+        }
+
+        return CREATECONST_STRING(out);
+    }
+
+    // string.replace(str, from, to) replaces every from in str with to
+    GValue _replacestring(GState* state, GArgs args) {
+        std::string_view str, from, to;
+        if (args.size() != 3) {
+            state->throwObjection("Expected 3 arguments, " + std::to_string(args.size()) + " given");
+            return CREATECONST_NIL();
+        }
+
+        if (!_stringArg(state, args, 0, str) || !_stringArg(state, args, 1, from) || !_stringArg(state, args, 2, to))
+            return CREATECONST_NIL();
+
+        if (from.empty()) {
+            state->throwObjection("Can't replace an empty string!");
+            return CREATECONST_NIL();
+        }
+
+        // count them first so we know how big the result is
+        size_t count = 0;
+        for (size_t pos = str.find(from); pos != std::string_view::npos; pos = str.find(from, pos + from.size()))
+            count++;
+
+        // nothing to replace, it's the same string
+        if (count == 0)
+            return args[0];
+
+        double size = (double)str.size() + (double)count * ((double)to.size() - (double)from.size());
+        if (!_reserveString(state, size))
+            return CREATECONST_NIL();
+
+        std::string& out = _stringBuffer((size_t)size);
+        size_t start = 0;
+        for (size_t pos = str.find(from); pos != std::string_view::npos; pos = str.find(from, start)) {
+            out += str.substr(start, pos - start);
+            out += to;
+            start = pos + from.size();
+        }
+        out += str.substr(start);
+
+        return CREATECONST_STRING(out);
+    }
+
+    // string.trim(str) removes the whitespace at the start & end
+    GValue _trimstring(GState* state, GArgs args) {
+        std::string_view str;
+        if (args.size() != 1) {
+            state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
+            return CREATECONST_NIL();
+        }
+
+        if (!_stringArg(state, args, 0, str))
+            return CREATECONST_NIL();
+
+        const char* whitespace = " \t\n\r\f\v";
+        size_t start = str.find_first_not_of(whitespace);
+        if (start == std::string_view::npos)
+            return CREATECONST_STRING("");
+
+        size_t end = str.find_last_not_of(whitespace) + 1;
+        if (start == 0 && end == str.size())
+            return args[0];
+
+        return CREATECONST_STRING(str.substr(start, end - start));
+    }
+
+    // string.startswith(str, prefix)
+    GValue _startswithstring(GState* state, GArgs args) {
+        std::string_view str, prefix;
+        if (args.size() != 2) {
+            state->throwObjection("Expected 2 arguments, " + std::to_string(args.size()) + " given");
+            return CREATECONST_NIL();
+        }
+
+        if (!_stringArg(state, args, 0, str) || !_stringArg(state, args, 1, prefix))
+            return CREATECONST_NIL();
+
+        return CREATECONST_BOOL(str.substr(0, prefix.size()) == prefix);
+    }
+
+    // string.rep(str, n, sep) returns str repeated n times, with the optional sep in between
+    GValue _repstring(GState* state, GArgs args) {
+        std::string_view str, sep;
+        double n;
+        if (args.size() != 2 && args.size() != 3) {
+            state->throwObjection("Expected 2 or 3 arguments, " + std::to_string(args.size()) + " given");
+            return CREATECONST_NIL();
+        }
+
+        if (!_stringArg(state, args, 0, str) || !_numberArg(state, args, 1, n) || (args.size() == 3 && !_stringArg(state, args, 2, sep)))
+            return CREATECONST_NIL();
+
+        n = std::floor(n);
+        if (!(n > 0)) // also catches NaN
+            return CREATECONST_STRING("");
+
+        // repeating nothing is nothing, no matter how many times (& checking the size below wouldn't stop the loop)
+        if (str.empty() && sep.empty())
+            return CREATECONST_STRING("");
+
+        // the size check also keeps n small enough for the size_t below
+        double size = n * str.size() + (n - 1) * sep.size();
+        if (!_reserveString(state, size))
+            return CREATECONST_NIL();
+
+        std::string& out = _stringBuffer((size_t)size);
+        for (size_t i = 0; i < (size_t)n; i++) {
+            if (i > 0)
+                out += sep;
+            out += str;
+        }
+
+        return CREATECONST_STRING(out);
+    }
 
     // ======================= [[ BIT ]] =======================
 
-    GValue _bnotbit(GState* state, std::vector<GValue>& args) {
+    GValue _bnotbit(GState* state, GArgs args) {
         if (args.size() != 1) {
             state->throwObjection("Expected 1 argument! " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4668,7 +7947,7 @@ namespace GavelLib {
         return CREATECONST_NUMBER(~((int)READGVALUENUMBER(args[0])));
     }
 
-    GValue _bandbit(GState* state, std::vector<GValue>& args) {
+    GValue _bandbit(GState* state, GArgs args) {
         if (args.size() == 0) {
             state->throwObjection("Expected at least 1 argument! " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4692,7 +7971,7 @@ namespace GavelLib {
         return CREATECONST_NUMBER(res);
     }
 
-    GValue _borbit(GState* state, std::vector<GValue>& args) {
+    GValue _borbit(GState* state, GArgs args) {
         if (args.size() == 0) {
             state->throwObjection("Expected at least 1 argument! " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4708,7 +7987,7 @@ namespace GavelLib {
         return CREATECONST_NUMBER(res);
     }
 
-    GValue _bxorbit(GState* state, std::vector<GValue>& args) {
+    GValue _bxorbit(GState* state, GArgs args) {
         if (args.size() == 0) {
             state->throwObjection("Expected at least 1 argument! " + std::to_string(args.size()) + " given");
             return CREATECONST_NIL();
@@ -4733,6 +8012,102 @@ namespace GavelLib {
         state->setGlobal("bit", tbl);
     }
 
+    // ======================= [[ GC ]] =======================
+
+    // reads the size argument for the gc.set* functions, anything past what a size_t can hold is clamped to SIZE_MAX
+    bool _gcNumberArg(GState* state, GArgs& args, size_t& out) {
+        if (args.size() != 1) {
+            state->throwObjection("Expected 1 argument, " + std::to_string(args.size()) + " given");
+            return false;
+        }
+
+        // !(n >= 0) also catches NaN
+        if (!ISGVALUENUMBER(args[0]) || !(READGVALUENUMBER(args[0]) >= 0)) {
+            state->throwObjection("Expected a [NUMBER] >= 0, got " + (ISGVALUENUMBER(args[0]) ? args[0].toString() : args[0].toStringDataType()));
+            return false;
+        }
+
+        double n = READGVALUENUMBER(args[0]);
+        out = n >= (double)SIZE_MAX ? SIZE_MAX : (size_t)n;
+        return true;
+    }
+
+    // library implementation for gc.collect, runs a full collection right now
+    GValue _gccollect(GState* state, GArgs args) {
+        Gavel::collectGarbage();
+        return CREATECONST_NIL();
+    }
+
+    // library implementation for gc.count, returns the bytes the GC is tracking
+    GValue _gccount(GState* state, GArgs args) {
+        return CREATECONST_NUMBER((double)Gavel::getIsolate()->bytesAllocated);
+    }
+
+    // library implementation for gc.stats, returns a table with the same fields as Gavel::GGCStats
+    GValue _gcstats(GState* state, GArgs args) {
+        Gavel::GGCStats stats = Gavel::getGCStats();
+        Gavel::GIsolate* iso = Gavel::getIsolate();
+
+        GObjectTable* objects = new GObjectTable();
+        for (int i = 1; i < GOBJECT_MAX; i++)
+            objects->setIndex(getObjTypeName(i), (double)stats.objects[i]);
+
+        GObjectTable* tbl = new GObjectTable();
+        tbl->setIndex("collections", (double)stats.collections);
+        tbl->setIndex("minorcollections", (double)stats.minorCollections);
+        tbl->setIndex("pauses", (double)stats.pauses);
+        tbl->setIndex("totalpause", stats.totalPause);
+        tbl->setIndex("longestpause", stats.longestPause);
+        tbl->setIndex("lastfreed", (double)stats.lastFreed);
+        tbl->setIndex("totalfreed", (double)stats.totalFreed);
+        tbl->setIndex("live", (double)stats.liveBytes);
+        tbl->setIndex("heap", (double)iso->bytesAllocated);
+        tbl->setIndex("threshold", (double)iso->nextGc);
+        tbl->setIndex("interned", (double)iso->strings.getSize());
+        tbl->setIndex("objects", objects);
+        return Gavel::newGValue(tbl);
+    }
+
+    GValue _gcsetgrowth(GState* state, GArgs args) {
+        size_t n;
+        if (_gcNumberArg(state, args, n))
+            Gavel::setGrowth(n);
+        return CREATECONST_NIL();
+    }
+
+    GValue _gcsetminthreshold(GState* state, GArgs args) {
+        size_t n;
+        if (_gcNumberArg(state, args, n))
+            Gavel::setMinThreshold(n);
+        return CREATECONST_NIL();
+    }
+
+    GValue _gcsetnurserysize(GState* state, GArgs args) {
+        size_t n;
+        if (_gcNumberArg(state, args, n))
+            Gavel::setNurserySize(n);
+        return CREATECONST_NIL();
+    }
+
+    GValue _gcsetmaxpause(GState* state, GArgs args) {
+        size_t n;
+        if (_gcNumberArg(state, args, n))
+            Gavel::setMaxPause(n);
+        return CREATECONST_NIL();
+    }
+
+    void loadGC(GState* state) {
+        GObjectTable* tbl = new GObjectTable();
+        tbl->setIndex("collect", &_gccollect);
+        tbl->setIndex("count", &_gccount);
+        tbl->setIndex("stats", &_gcstats);
+        tbl->setIndex("setgrowth", &_gcsetgrowth);
+        tbl->setIndex("setminthreshold", &_gcsetminthreshold);
+        tbl->setIndex("setnurserysize", &_gcsetnurserysize);
+        tbl->setIndex("setmaxpause", &_gcsetmaxpause);
+        state->setGlobal("gc", tbl);
+    }
+
     void loadIO(GState* state) {
         state->setGlobal("print", &_print);
         state->setGlobal("input", &_input);
@@ -4746,6 +8121,13 @@ namespace GavelLib {
         tbl->setIndex("lower", &_lowerstring);
         tbl->setIndex("upper", &_upperstring);
         tbl->setIndex("find", &_findstring);
+        tbl->setIndex("split", &_splitstring);
+        tbl->setIndex("join", &_joinstring);
+        tbl->setIndex("format", &_formatstring);
+        tbl->setIndex("replace", &_replacestring);
+        tbl->setIndex("trim", &_trimstring);
+        tbl->setIndex("startswith", &_startswithstring);
+        tbl->setIndex("rep", &_repstring);
         state->setGlobal("string", tbl);
     }
 
@@ -4754,6 +8136,7 @@ namespace GavelLib {
         loadMath(state);
         loadString(state);
         loadBit(state);
+        loadGC(state);
 
         state->setGlobal("tonumber", &_tonumber);
         state->setGlobal("tostring", &_tostring);
@@ -4765,6 +8148,7 @@ namespace GavelLib {
 #else
     // this is the only public-facing API anyone should be using!
     void loadBit(GState* state);
+    void loadGC(GState* state);
     void loadIO(GState* state);
     void loadString(GState* state);
     void loadLibrary(GState* state);
@@ -4774,7 +8158,7 @@ namespace GavelLib {
 
 // ===========================================================================[[ (DE)SERIALIZER/(UN)DUMPER ]]===========================================================================
 
-#define GCODEC_VERSION_BYTE '\x01'
+#define GCODEC_VERSION_BYTE '\x03'
 #define GCODEC_HEADER_MAGIC "COSMO"
 
 // TODO: add support for comparing double sizes to be more platform independent
@@ -4821,19 +8205,25 @@ private:
             // skips GOBJECT_NULL; there's nothing to do
             case GOBJECT_STRING:
                 // writes string to stream!
-                writeRawString(READOBJECTVALUE(obj, GObjectString*).c_str(), READOBJECTVALUE(obj, GObjectString*).size());
+                writeRawString(reinterpret_cast<GObjectString*>(obj)->str().data(), reinterpret_cast<GObjectString*>(obj)->str().size());
                 break;
-            case GOBJECT_TABLE:
+            case GOBJECT_TABLE: {
                 // NOTE: vanilla GavelScript doesn't generate tables in the constant list, however i'm adding
                 // support for serializing tables because this project is designed to be very hackable so if you 
                 // wanted to add support for constant tables in the parser, you can!
 
-                writeSizeT(READOBJECTVALUE(obj, GObjectTable*).getSize());
-                for (auto pair : READOBJECTVALUE(obj, GObjectTable*).hashTable) {
-                    writeValue(pair.first.key); // first write the key
-                    writeValue(pair.second); // then the value
+                GObjectTable* tbl = reinterpret_cast<GObjectTable*>(obj);
+                writeSizeT(tbl->getLength());
+                for (size_t i = 0; i < tbl->arr.size(); i++) {
+                    writeValue(CREATECONST_NUMBER(i)); // first write the key
+                    writeValue(tbl->arr[i]); // then the value
+                }
+                for (auto& node : tbl->val) {
+                    writeValue(node.key);
+                    writeValue(node.val);
                 }
                 break;
+            }
             case GOBJECT_FUNCTION: {
                 GObjectFunction* func = reinterpret_cast<GObjectFunction*>(obj);
                 writeRawString(func->getName().c_str(), func->getName().size()); // first the name
@@ -4849,18 +8239,21 @@ private:
     }
 
     void writeValue(GValue val) {
-        writeByte(val.type); // writes the type first
-        switch(val.type) {
+        GType type = GETGVALUETYPE(val);
+        writeByte(type); // writes the type first
+        switch(type) {
             // skips GAVEL_TNIL; there's nothing to do
             case GAVEL_TBOOLEAN:
                 writeByte(READGVALUEBOOL(val)); // writes the value of true/false
                 break;
-            case GAVEL_TNUMBER:
+            case GAVEL_TNUMBER: {
                 // writes double as bytes to stream (this is basically the only thing platform dependant)
-                data.write(reinterpret_cast<const char*>(&READGVALUENUMBER(val)), sizeof(double));
+                double num = READGVALUENUMBER(val);
+                data.write(reinterpret_cast<const char*>(&num), sizeof(double));
                 break;
+            }
             case GAVEL_TOBJ:
-                writeObject(val.val.obj);
+                writeObject(READGVALUEOBJ(val));
                 break;
             default:
                 // no data to write
@@ -4871,7 +8264,7 @@ private:
     void writeIdentifiers(std::vector<GObjectString*> idnts) {
         writeSizeT(idnts.size());
         for (GObjectString* str : idnts) {
-            writeRawString(str->val.c_str(), str->val.size());
+            writeRawString(str->str().data(), str->str().size());
         }
     }
 
@@ -5015,6 +8408,12 @@ private:
         if (reverseEndian)
             reverseBytes(&op, sizeof(op));
 
+        // the vm jumps straight into it's dispatch table with this, so it better be a real opcode!
+        if (op > OP_END) {
+            throwObjection("Malformed binary!");
+            return CREATE_i(OP_END);
+        }
+
         switch (GInstructionTypes[op]) {
             case OPTYPE_CLOSURE: // closures are secretly IAx instructions. shhh!
             case OPTYPE_IAX: {
@@ -5025,6 +8424,11 @@ private:
                 tmp = CREATE_iAx(op, ax);
                 break;
             }
+            case OPTYPE_IABC: {
+                int a = GETARG_A(tmp), b = GETARG_B(tmp), c = GETARG_C(tmp);
+                tmp = CREATE_iABC(op, a, b, c);
+                break;
+            }
             case OPTYPE_I: // you're done, you don't need to decode anything
                 tmp = CREATE_i(op);
             default:
@@ -5151,6 +8555,7 @@ private:
         // read the identifiers
         DEBUGLOG(std::cout << "[DUMP] - Reading identifiers" << std::endl);
         chk->identifiers = readIdentifiers();
+        chk->globalCache.resize(chk->identifiers.size());
         // read the constants
         DEBUGLOG(std::cout << "[DUMP] - Reading constants" << std::endl);
         chk->constants = readConstants();
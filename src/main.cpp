@@ -18,7 +18,7 @@ public:
         GValue tblVal = state->stack.getTop(0); // prototable will always be the top value on the stack
 
         if (!ISGVALUEPROTOTABLE(tblVal)) { // sanity check
-            std::cout << "failed aaaa!! [" << tblVal.type << "]" << std::endl;
+            std::cout << "failed aaaa!! [" << GETGVALUETYPE(tblVal) << "]" << std::endl;
             return CREATECONST_NIL();
         }
 
@@ -29,7 +29,259 @@ public:
     }
 };
 
+/* heap snapshot analyzer (Gavel --heap <file>)
+    Reads a snapshot written by Gavel::writeHeapSnapshot() & builds the dominator tree of it's graph. An object's retained size is everything that would be
+freed if it was gone (itself & everything it dominates). Prints the retained size by type, the biggest retainers & the path of dominators that keeps them alive.
+*/
+struct HeapNode {
+    uint8_t type;
+    uint64_t size;
+    std::string name;
+    std::vector<uint32_t> refs;
+    std::vector<uint32_t> referrers;
+    int order = -1; // reverse postorder index, -1 if it's unreachable (shouldn't happen, everything written was reachable)
+    uint32_t idom = 0;
+    uint64_t retained = 0;
+};
+
+template <typename T>
+static bool readRaw(std::istream& in, T& x) {
+    return (bool)in.read(reinterpret_cast<char*>(&x), sizeof(T));
+}
+
+static bool readHeapSnapshot(const char* path, std::vector<HeapNode>& nodes) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(GSNAPSHOT_MAGIC) - 1];
+    uint8_t version;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, GSNAPSHOT_MAGIC, sizeof(magic)) != 0 || !readRaw(in, version) || version != GSNAPSHOT_VERSION)
+        return false;
+
+    uint32_t count;
+    if (!readRaw(in, count))
+        return false;
+
+    nodes.resize(count);
+    for (HeapNode& node : nodes) {
+        uint32_t nameLen;
+        if (!readRaw(in, node.type) || !readRaw(in, node.size) || !readRaw(in, nameLen))
+            return false;
+        node.name.resize(nameLen);
+        if (!in.read(&node.name[0], nameLen))
+            return false;
+    }
+
+    uint32_t edges;
+    if (!readRaw(in, edges))
+        return false;
+
+    for (uint32_t i = 0; i < edges; i++) {
+        uint32_t from, to;
+        if (!readRaw(in, from) || !readRaw(in, to) || from >= count || to >= count)
+            return false;
+        nodes[from].refs.push_back(to);
+        nodes[to].referrers.push_back(from);
+    }
+    return count > 0;
+}
+
+// Cooper, Harvey & Kennedy's "A Simple, Fast Dominance Algorithm". node 0 is the root
+static std::vector<uint32_t> computeDominators(std::vector<HeapNode>& nodes) {
+    // iterative DFS for the postorder, the heap can be way too deep to recurse
+    std::vector<uint32_t> postorder;
+    std::vector<bool> seen(nodes.size(), false);
+    std::vector<std::pair<uint32_t, size_t>> stack = {{0, 0}};
+    seen[0] = true;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second < nodes[top.first].refs.size()) {
+            uint32_t next = nodes[top.first].refs[top.second++];
+            if (!seen[next]) {
+                seen[next] = true;
+                stack.push_back({next, 0});
+            }
+        } else {
+            postorder.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+
+    std::vector<uint32_t> rpo(postorder.rbegin(), postorder.rend());
+    for (size_t i = 0; i < rpo.size(); i++)
+        nodes[rpo[i]].order = i;
+
+    const uint32_t undefined = UINT32_MAX;
+    std::vector<uint32_t> idom(nodes.size(), undefined);
+    idom[0] = 0;
+
+    auto intersect = [&](uint32_t a, uint32_t b) {
+        while (a != b) {
+            while (nodes[a].order > nodes[b].order)
+                a = idom[a];
+            while (nodes[b].order > nodes[a].order)
+                b = idom[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++) {
+            uint32_t n = rpo[i];
+            uint32_t newIdom = undefined;
+            for (uint32_t p : nodes[n].referrers) {
+                if (idom[p] == undefined)
+                    continue;
+                newIdom = newIdom == undefined ? p : intersect(p, newIdom);
+            }
+
+            if (newIdom != idom[n]) {
+                idom[n] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    for (uint32_t n : rpo)
+        nodes[n].idom = idom[n];
+    return rpo;
+}
+
+static std::string describeNode(HeapNode& node) {
+    if (node.type == GOBJECT_NULL)
+        return node.name; // one of the roots
+    return std::string(getObjTypeName(node.type)) + (node.name.empty() ? "" : " '" + node.name + "'");
+}
+
+static int analyzeHeapSnapshot(const char* path) {
+    std::vector<HeapNode> nodes;
+    if (!readHeapSnapshot(path, nodes)) {
+        std::cout << path << ": not a heap snapshot (or it's from a different version)" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> rpo = computeDominators(nodes);
+
+    // retained sizes, children come after their dominator in rpo so walking it backwards adds every subtree up
+    for (uint32_t n : rpo)
+        nodes[n].retained = nodes[n].size;
+    for (size_t i = rpo.size() - 1; i > 0; i--)
+        nodes[nodes[rpo[i]].idom].retained += nodes[rpo[i]].retained;
+
+    // retained by type: every node counts towards each type on it's dominator path (including itself)
+    std::vector<uint32_t> typeMask(nodes.size(), 0);
+    uint64_t count[GOBJECT_MAX] = {}, shallow[GOBJECT_MAX] = {}, retained[GOBJECT_MAX] = {};
+    for (uint32_t n : rpo) {
+        HeapNode& node = nodes[n];
+        typeMask[n] = (n == 0 ? 0 : typeMask[node.idom]) | (node.type != GOBJECT_NULL && node.type < GOBJECT_MAX ? 1 << node.type : 0);
+        if (node.type == GOBJECT_NULL || node.type >= GOBJECT_MAX)
+            continue;
+
+        count[node.type]++;
+        shallow[node.type] += node.size;
+        for (int t = 0; t < GOBJECT_MAX; t++) {
+            if (typeMask[n] & (1 << t))
+                retained[t] += node.size;
+        }
+    }
+
+    std::cout << path << ": " << rpo.size() << " nodes, " << nodes[0].retained / 1024.0 << "KB reachable" << std::endl << std::endl;
+    std::cout << std::left << std::setw(12) << "type" << std::right << std::setw(10) << "count" << std::setw(14) << "shallow KB" << std::setw(14) << "retained KB" << std::endl;
+    for (int t = 1; t < GOBJECT_MAX; t++) {
+        if (count[t] == 0)
+            continue;
+        std::cout << std::left << std::setw(12) << getObjTypeName(t) << std::right << std::setw(10) << count[t] << std::setw(14) << std::fixed << std::setprecision(1) << shallow[t] / 1024.0 << std::setw(14) << retained[t] / 1024.0 << std::endl;
+    }
+
+    // the biggest retainers that are actual objects
+    std::vector<uint32_t> top;
+    for (uint32_t n : rpo) {
+        if (nodes[n].type != GOBJECT_NULL)
+            top.push_back(n);
+    }
+    size_t shown = std::min<size_t>(top.size(), 10);
+    std::partial_sort(top.begin(), top.begin() + shown, top.end(), [&](uint32_t a, uint32_t b) { return nodes[a].retained > nodes[b].retained; });
+
+    std::cout << std::endl << "top retainers:" << std::endl;
+    for (size_t i = 0; i < shown; i++) {
+        HeapNode& node = nodes[top[i]];
+        std::cout << std::setw(10) << node.retained / 1024.0 << "KB  " << describeNode(node) << std::endl;
+
+        // dominator path, from the root down to this node
+        std::vector<uint32_t> path;
+        for (uint32_t n = node.idom; n != 0; n = nodes[n].idom)
+            path.push_back(n);
+
+        std::cout << "              (roots)";
+        for (auto it = path.rbegin(); it != path.rend(); it++)
+            std::cout << " > " << describeNode(nodes[*it]);
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+/* test runner (Gavel --test <script>)
+    Scripts can't catch objections, so a test that checks more than one would stop at the first. This runs every section of the script (split by lines that
+are just "// ---") one after another in the same state, printing objections like a normal run & going on to the next section. Globals carry over, locals 
+don't. Each section is padded with blank lines so objections still give the line in the whole file. 'make test' runs tests/*.gs with this.
+*/
+int runTestScript(const char* path) {
+    std::ifstream ifs(path);
+    if (!ifs) {
+        std::cout << "couldn't open " << path << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> sections(1);
+    std::string line;
+    int lineNum = 0;
+    while (std::getline(ifs, line)) {
+        lineNum++;
+        if (line == "// ---") {
+            sections.push_back(std::string(lineNum, '\n'));
+            continue;
+        }
+        sections.back() += line + "\n";
+    }
+
+    GState* state = Gavel::newState();
+    GavelLib::loadLibrary(state);
+    std::vector<GObjectFunction*> funcs; // later sections can still call functions from earlier ones, so these are freed at the end
+
+    for (std::string& section : sections) {
+        GavelParser compiler(section.c_str());
+        if (!compiler.compile()) {
+            std::cout << path << ": " << compiler.getObjection().getFormatedString() << std::endl;
+            continue;
+        }
+
+        GObjectFunction* mainFunc = compiler.getFunction();
+        if (state->start(mainFunc) != GSTATE_OK)
+            std::cout << path << ": " << state->getObjection().getFormatedString() << std::endl;
+        funcs.push_back(mainFunc);
+    }
+
+    Gavel::freeState(state);
+    for (GObjectFunction* f : funcs)
+        delete f;
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc > 2 && strcmp(argv[1], "--heap") == 0)
+        return analyzeHeapSnapshot(argv[2]);
+
+    if (argc > 2 && strcmp(argv[1], "--test") == 0)
+        return runTestScript(argv[2]);
+
+    // Gavel --snapshot <out> <script> runs the script & writes a heap snapshot when it's done
+    const char* snapshotPath = NULL;
+    if (argc > 3 && strcmp(argv[1], "--snapshot") == 0) {
+        snapshotPath = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc > 1) { // if they're passing filenames to run
         // default is to run the file
 
@@ -78,6 +330,12 @@ int main(int argc, char* argv[]) {
             std::cout << argv[1] << ": " << state->getObjection().getFormatedString() << std::endl;
         }
 
+        if (snapshotPath != NULL) {
+            std::ofstream fout(snapshotPath, std::ios::binary | std::ios::out);
+            Gavel::writeHeapSnapshot(fout);
+            std::cout << "Wrote heap snapshot to " << snapshotPath << std::endl;
+        }
+
         delete mainFunc;
         Gavel::freeState(state);
         return 0;
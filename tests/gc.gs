@@ -0,0 +1,57 @@
+// the gc library, 'make test' runs this with 'Gavel --test' so every section (split by "// ---") gets to run even if the one before raised an objection
+// (check is a global so the last section can still use it)
+var check = function(name, got, want)
+    if got == want then
+        print("ok   ", name)
+    else
+        print("FAIL ", name, ": got '", got, "', expected '", want, "'")
+    end
+end
+
+// gc.stats() has every documented field, & they're numbers (objects is a table of counts by type)
+local stats = gc.stats()
+local fields = {"collections", "minorcollections", "pauses", "totalpause", "longestpause", "lastfreed", "totalfreed", "live", "heap", "threshold", "interned"}
+for (var i = 0; i < #fields; i++) do
+    check("stats." .. fields[i], type(stats[fields[i]]), type(0))
+end
+check("stats.objects", type(stats.objects), type({}))
+check("stats.objects.string", type(stats.objects.string), type(0))
+check("stats.objects.table", stats.objects.table > 0, true)
+
+// collect & count
+gc.collect()
+check("collect counted", gc.stats().collections > stats.collections, true)
+check("count is heap", gc.count(), gc.stats().heap)
+
+// huge sizes are clamped to what a size_t can hold, & the next threshold doesn't wrap around to something tiny
+local huge = 1
+for (var i = 0; i < 40; i++) do
+    huge = huge * 1000
+end
+gc.setgrowth(huge)
+gc.setminthreshold(huge)
+gc.setnurserysize(huge)
+gc.setmaxpause(huge)
+gc.collect()
+check("huge threshold", gc.stats().threshold > 1000000000000, true)
+
+// 0 is allowed
+gc.setmaxpause(0)
+gc.setnurserysize(0)
+gc.setminthreshold(0)
+check("zero accepted", true, true)
+print("rejected:")
+// ---
+gc.setgrowth(-(0/0)) // negated, so it prints as nan in every build
+// ---
+gc.setminthreshold(-1)
+// ---
+gc.setnurserysize(-1/0)
+// ---
+gc.setmaxpause("100")
+// ---
+gc.setgrowth()
+// ---
+gc.setgrowth(1, 2)
+// ---
+check("still running", gc.count() > 0, true)
@@ -0,0 +1,84 @@
+/* memory limit tests
+    Every way a script can allocate a lot has to stop at the isolate's memory limit (see Gavel::setMemoryLimit()) with a "memory limit exceeded" objection 
+    instead of going past it. Each case runs in it's own isolate with a 4MB limit, & a small script has to still run fine under it.
+
+    built & ran by 'make test'
+*/
+
+#define _GAVEL_INIT
+#include "../src/gavel.h"
+
+#define MEMLIMIT (4 * 1024 * 1024)
+
+struct MemCase {
+    const char* name;
+    const char* script;
+    bool exceeds; // if it's supposed to hit the limit
+};
+
+static const MemCase cases[] = {
+    {"under the limit", 
+        "local t = {}\n"
+        "for (var i = 0; i < 1000; i++) do\n"
+        "    t[i] = string.rep(\"x\", 100) .. i\n"
+        "end\n", false},
+    {"concat ropes", 
+        "local x = string.rep(\"y\", 100)\n"
+        "local s = \"\"\n"
+        "for (var i = 0; i < 1000000; i++) do\n"
+        "    s = s .. x\n"
+        "end\n", true},
+    {"new tables", 
+        "local t = {}\n"
+        "for (var i = 0; i < 1000000; i++) do\n"
+        "    t[i] = {i}\n"
+        "end\n", true},
+    {"string.rep", 
+        "local s = string.rep(\"x\", 8 * 1024 * 1024)\n", true},
+    {"string.split", 
+        "local parts = string.split(string.rep(\"a,\", 1000000), \",\")\n", true},
+};
+
+static bool runCase(const MemCase& c) {
+    Gavel::GIsolate* iso = Gavel::newIsolate();
+    GState* state = Gavel::newState(iso); // also makes iso current
+    GavelLib::loadLibrary(state);
+    Gavel::setMemoryLimit(MEMLIMIT);
+
+    GavelParser compiler(c.script);
+    if (!compiler.compile()) {
+        std::cout << "memlimit: " << c.name << ": " << compiler.getObjection().getFormatedString() << std::endl;
+        Gavel::freeIsolate(iso);
+        return false;
+    }
+
+    GObjectFunction* mainFunc = compiler.getFunction();
+    bool objection = state->start(mainFunc) != GSTATE_OK;
+    std::string msg = objection ? state->getObjection().getFormatedString() : "";
+    size_t used = Gavel::getIsolate()->bytesAllocated;
+
+    delete mainFunc;
+    Gavel::freeIsolate(iso);
+
+    bool ok;
+    if (c.exceeds)
+        ok = objection && msg.find("memory limit exceeded") != std::string::npos;
+    else
+        ok = !objection && used <= MEMLIMIT;
+
+    if (!ok)
+        std::cout << "memlimit: FAIL " << c.name << (objection ? ": " + msg : std::string(": no objection")) << std::endl;
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+    for (const MemCase& c : cases)
+        ok = runCase(c) && ok;
+
+    if (!ok)
+        return 1;
+
+    std::cout << "memlimit: ok" << std::endl;
+    return 0;
+}
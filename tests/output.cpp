@@ -0,0 +1,61 @@
+/* GOutput tests
+    Buffered print output has to reach the sink while a script is still running, not just when it returns. A loop that only computes (no calls or
+    allocations) only goes through OP_JMPBACK, so that's where the VM has to check the flush interval.
+
+    built & ran by 'make test'
+*/
+
+#define _GAVEL_INIT
+#include "../src/gavel.h"
+
+static bool gotOutput = false;
+static bool gotOutputInLoop = false;
+
+static void onOutput(const char* data, size_t len, void* userData) {
+    if (std::string_view(data, len).find("started") != std::string_view::npos)
+        gotOutput = true;
+}
+
+// the script calls this after the loop, before it returns & the state flushes for the last time
+static GValue afterLoop(GState* state, GArgs args) {
+    gotOutputInLoop = gotOutput;
+    return CREATECONST_NIL();
+}
+
+int main() {
+    const char* script = 
+        "print(\"started\")\n"
+        "local i = 0\n"
+        "while i < 5000000 do\n"
+        "    i = i + 1\n"
+        "end\n"
+        "afterLoop()\n";
+
+    GState* state = Gavel::newState();
+    GavelLib::loadLibrary(state);
+    state->setGlobal("afterLoop", &afterLoop);
+
+    GCallbackSink sink(onOutput);
+    state->output.setSink(&sink);
+    state->output.setFlushInterval(1);
+
+    GavelParser compiler(script);
+    if (!compiler.compile()) {
+        std::cout << "output: " << compiler.getObjection().getFormatedString() << std::endl;
+        return 1;
+    }
+
+    GObjectFunction* mainFunc = compiler.getFunction();
+    bool ran = state->start(mainFunc) == GSTATE_OK;
+    state->output.setSink(NULL);
+    delete mainFunc;
+    Gavel::freeState(state);
+
+    if (!ran || !gotOutputInLoop) {
+        std::cout << "output: FAIL print output didn't reach the sink while the loop was running" << std::endl;
+        return 1;
+    }
+
+    std::cout << "output: ok" << std::endl;
+    return 0;
+}
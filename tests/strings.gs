@@ -0,0 +1,47 @@
+// edge cases for the native string library, `make test` diffs this script's output against strings.expected
+local check = function(name, got, want)
+    if got == want then
+        print("ok   ", name)
+    else
+        print("FAIL ", name, ": got '", got, "', expected '", want, "'")
+    end
+end
+
+// split with an empty sep gives single characters, a missing sep gives the whole string
+local chars = string.split("abc", "")
+check("split empty sep count", #chars, 3)
+check("split empty sep pieces", string.join(chars, "|"), "a|b|c")
+check("split empty string", #string.split("", ","), 1)
+check("split trailing sep", string.join(string.split("a,b,", ","), "|"), "a|b|")
+check("split no match", string.join(string.split("abc", ";"), "|"), "abc")
+
+// replace doesn't rescan what it just replaced, & overlapping matches are taken left to right
+check("replace overlap even", string.replace("aaaa", "aa", "b"), "bb")
+check("replace overlap odd", string.replace("aaa", "aa", "x"), "xa")
+check("replace grows", string.replace("aa", "a", "aa"), "aaaa")
+check("replace to empty", string.replace("banana", "a", ""), "bnn")
+
+// trim
+check("trim all whitespace", string.trim("  \t\n "), "")
+check("trim empty", string.trim(""), "")
+check("trim inner kept", string.trim("  a b  "), "a b")
+
+check("startswith longer prefix", string.startswith("ab", "abc"), false)
+check("startswith empty prefix", string.startswith("ab", ""), true)
+check("startswith itself", string.startswith("ab", "ab"), true)
+
+// rep
+check("rep empty str & sep", string.rep("", 1000000000, ""), "")
+check("rep zero", string.rep("ab", 0), "")
+check("rep negative", string.rep("ab", -3), "")
+check("rep sep", string.rep("ab", 3, ","), "ab,ab,ab")
+
+// format
+check("format percent", string.format("100%%"), "100%")
+check("format percent between", string.format("%d%%%s", 5, "!"), "5%!")
+check("format hex", string.format("%x", 255), "ff")
+check("format char", string.format("%c", 65), "A")
+check("format negative int", string.format("%d", -7.9), "-7")
+
+// a trailing % is an objection, & there's no way to catch it here so it has to come last
+print(string.format("50%"))